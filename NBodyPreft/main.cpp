@@ -157,7 +157,8 @@ double mysecond()
 std::vector<std::vector<double> >
 numa_domain_worker(std::size_t domain, hpx::lcos::local::latch& l,
     std::size_t part_size, std::size_t iterations,
-    std::size_t prefetch_distance_factor, std::size_t range_size)
+    std::size_t prefetch_distance_factor, std::size_t range_size,
+    bool prefetch_helper, std::size_t outstanding_lines)
 {
     l.count_down_and_wait();
 
@@ -168,9 +169,24 @@ numa_domain_worker(std::size_t domain, hpx::lcos::local::latch& l,
         for(std::size_t i=0; i<range_size; ++i)
             range[i]=i;
 
+    // body i accesses a[6*i .. 6*i+2] and b[6*i+3 .. 6*i+5]
+    using hpx::parallel::util::make_strided_prefetch_container;
     auto ctx = hpx::parallel::util::make_prefetcher_context(range.begin(),
         range.end(), prefetch_distance_factor,
-        a1, b1, a2, b2, a3, b3, a4, b4, a5, b5);
+        make_strided_prefetch_container(a1, 6, 0, 3),
+        make_strided_prefetch_container(b1, 6, 3, 3),
+        make_strided_prefetch_container(a2, 6, 0, 3),
+        make_strided_prefetch_container(b2, 6, 3, 3),
+        make_strided_prefetch_container(a3, 6, 0, 3),
+        make_strided_prefetch_container(b3, 6, 3, 3),
+        make_strided_prefetch_container(a4, 6, 0, 3),
+        make_strided_prefetch_container(b4, 6, 3, 3),
+        make_strided_prefetch_container(a5, 6, 0, 3),
+        make_strided_prefetch_container(b5, 6, 3, 3));
+    if (prefetch_helper)
+        ctx.enable_helper_thread();
+    if (outstanding_lines != 0)
+        ctx.limit_outstanding_lines(outstanding_lines);
 
     for(std::size_t it=0 ; it!=iterations; ++it)
     {
@@ -352,6 +368,12 @@ int hpx_main(boost::program_options::variables_map& vm)
     std::size_t prefetch_distance_factor = vm["prefetch_distance_factor"].as<std::size_t>();
     std::size_t range_size = vm["range_size"].as<std::size_t>();
     std::size_t problem_size = vm["problem_size"].as<std::size_t>();
+    bool prefetch_helper = vm.count("prefetch_helper") != 0;
+    std::size_t outstanding_lines = vm["outstanding_lines"].as<std::size_t>();
+
+    // measure the memory latency before any of the timed loops runs
+    if (prefetch_distance_factor == 0)
+        hpx::parallel::util::calibrate_prefetcher();
 
     using namespace hpx::parallel;
 
@@ -392,7 +414,8 @@ int hpx_main(boost::program_options::variables_map& vm)
         workers.push_back(
             hpx::async(execs[i], &numa_domain_worker,
                 i, boost::ref(l),
-                part_size, iterations, prefetch_distance_factor, range_size)
+                part_size, iterations, prefetch_distance_factor, range_size,
+                prefetch_helper, outstanding_lines)
             );
     }
 
@@ -488,7 +511,15 @@ int main(int argc, char* argv[])
             "number of NUMA domains to use. (default: all)")
         (   "prefetch_distance_factor",
             boost::program_options::value<std::size_t>()->default_value(20),
-            "Distance (in chunk_size) between each preteching data. (default: 1)")
+            "Distance (in chunk_size) between each preteching data, 0 "
+            "calibrates the prefetch distance at startup. (default: 20)")
+        (   "prefetch_helper",
+            "issue the prefetches from a helper thread on the SMT sibling "
+            "of each worker (use one worker per core)")
+        (   "outstanding_lines",
+            boost::program_options::value<std::size_t>()->default_value(0),
+            "maximal number of cache lines each worker prefetches at once, "
+            "0 does not limit the prefetches. (default: 0)")
         (   "range_size",
             boost::program_options::value<std::size_t>()->default_value(100000000),
             "size of range. (default: 100000000)")
@@ -0,0 +1,297 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_BANDWIDTH_THROTTLE_HPP)
+#define HPX_PARALLEL_UTIL_BANDWIDTH_THROTTLE_HPP
+
+#include <hpx/config.hpp>
+#include <hpx/hpx_fwd.hpp>
+#include <hpx/runtime/threads/topology.hpp>
+#include <hpx/util/hardware/timestamp.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace hpx { namespace parallel { namespace util
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Throttles the prefetches of the loops running in one NUMA domain while
+    // its memory bandwidth is saturated, in which case additional prefetches
+    // only add to the queueing delay of the memory controller.
+    //
+    // The workers of all contexts sharing the throttle report the bytes of
+    // the containers they retired and the bytes they request ahead (their
+    // prefetch distance times the footprint of a chunk, before throttling).
+    // Over windows of window_ticks timestamp ticks the throttle estimates
+    // the bandwidth achieved by the domain and the demand, the bytes
+    // requested ahead averaged over the window. By Little's law the
+    // bandwidth follows the demand as long as the latency stays the same.
+    // A window in which the demand rose but the bandwidth grew by less than
+    // high_watermark of it (i.e. the bandwidth levelled off, the requests
+    // queue up) raises the throttle level by one. The level drops again
+    // once the demand falls back to where the bandwidth still followed it,
+    // or if throttling lowered the bandwidth below low_watermark of what it
+    // was when the level was raised (i.e. the loops weren't bandwidth
+    // bound). At level n the prefetch distance is divided by 2^n and the
+    // near level of two level schedules is dropped. A loop running with a
+    // steady demand is never throttled.
+    class bandwidth_throttle
+    {
+    public:
+        static unsigned const max_level = 3;
+
+        // the number of bytes a worker retires before it reports them
+        static std::size_t const report_bytes = 1 << 18;
+
+        explicit bandwidth_throttle(std::uint64_t window_ticks = 1 << 20,
+                double high_watermark = 0.9, double low_watermark = 0.7)
+          : level_(0), window_ticks_(window_ticks),
+            high_watermark_(high_watermark), low_watermark_(low_watermark),
+            bytes_(0), demand_ticks_(0),
+            start_(hpx::util::hardware::timestamp()), bandwidth_(0),
+            demand_(0), peak_(0), windows_(0),
+            saturated_windows_(0)
+        {}
+
+        bandwidth_throttle(bandwidth_throttle const&) = delete;
+        bandwidth_throttle& operator=(bandwidth_throttle const&) = delete;
+
+        ///////////////////////////////////////////////////////////////////////
+        // The bytes retired by one worker, accumulated locally and reported
+        // to the throttle every report_bytes bytes and when the worker is
+        // done, such that the shared counters and the timestamp counter are
+        // touched only a few times per window.
+        class reporter
+        {
+        public:
+            explicit reporter(bandwidth_throttle& throttle)
+              : throttle_(throttle), bytes_(0), in_flight_(0),
+                start_(hpx::util::hardware::timestamp())
+            {}
+
+            ~reporter()
+            {
+                report();
+            }
+
+            reporter(reporter const&) = delete;
+            reporter& operator=(reporter const&) = delete;
+
+            // account for the bytes retired by a chunk, in_flight are the
+            // bytes the worker requests ahead
+            HPX_FORCEINLINE void retire(std::size_t bytes,
+                std::size_t in_flight)
+            {
+                bytes_ += bytes;
+                in_flight_ = in_flight;
+                if (bytes_ >= report_bytes)
+                    report();
+            }
+
+            void report()
+            {
+                if (bytes_ == 0)
+                    return;
+
+                std::uint64_t const now = hpx::util::hardware::timestamp();
+                throttle_.report(bytes_, in_flight_, now - start_, now);
+                bytes_ = 0;
+                start_ = now;
+            }
+
+        private:
+            bandwidth_throttle& throttle_;
+            std::size_t bytes_;
+            std::size_t in_flight_;
+            std::uint64_t start_;
+        };
+
+        // the distance to use instead of the given one, a distance of zero
+        // (no prefetches) is left alone
+        HPX_FORCEINLINE std::size_t distance(std::size_t d) const
+        {
+            if (d == 0)
+                return 0;
+            d >>= level();
+            return d == 0 ? 1 : d;
+        }
+
+        unsigned level() const
+        {
+            return level_.load(std::memory_order_relaxed);
+        }
+
+        bool throttled() const
+        {
+            return level() != 0;
+        }
+
+        // the highest bandwidth measured so far, in bytes per tick
+        double peak_bandwidth() const
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            return peak_;
+        }
+
+        // the number of closed windows and of those in which the bandwidth
+        // levelled off while the demand rose
+        std::size_t windows() const
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            return windows_;
+        }
+
+        std::size_t saturated_windows() const
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            return saturated_windows_;
+        }
+
+        // account for the bytes retired by a worker over the given number
+        // of ticks, the worker which is first to see the end of the current
+        // window closes it
+        void report(std::size_t bytes, std::size_t in_flight,
+            std::uint64_t ticks, std::uint64_t now)
+        {
+            bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            demand_ticks_.fetch_add(std::uint64_t(in_flight) * ticks,
+                std::memory_order_relaxed);
+
+            // the timestamp counters of the cores may be slightly off
+            std::uint64_t start = start_.load(std::memory_order_relaxed);
+            if (now < start || now - start < window_ticks_)
+                return;
+
+            if (start_.compare_exchange_strong(start, now,
+                    std::memory_order_relaxed))
+            {
+                double const window = double(now - start);
+                std::size_t const retired =
+                    bytes_.exchange(0, std::memory_order_relaxed);
+                std::uint64_t const demand =
+                    demand_ticks_.exchange(0, std::memory_order_relaxed);
+                close_window(double(retired) / window,
+                    double(demand) / window);
+            }
+        }
+
+    private:
+        void close_window(double bandwidth, double demand)
+        {
+            // the demand has to rise by this factor to count as rising
+            double const min_growth = 1.1;
+
+            std::lock_guard<std::mutex> l(mtx_);
+
+            ++windows_;
+            if (bandwidth > peak_)
+                peak_ = bandwidth;
+
+            unsigned level = level_.load(std::memory_order_relaxed);
+            if (bandwidth_ != 0 && demand_ != 0 && demand != 0)
+            {
+                double const demand_growth = demand / demand_;
+                double const bandwidth_growth = bandwidth / bandwidth_;
+
+                if (demand_growth >= min_growth &&
+                    bandwidth_growth < high_watermark_ * demand_growth)
+                {
+                    ++saturated_windows_;
+                    if (level != max_level)
+                    {
+                        raised_[level].demand = demand_;
+                        raised_[level].bandwidth =
+                            bandwidth > bandwidth_ ? bandwidth : bandwidth_;
+                        ++level;
+                    }
+                }
+                else if (level != 0 &&
+                    (demand <= raised_[level - 1].demand ||
+                     bandwidth < low_watermark_ * raised_[level - 1].bandwidth))
+                {
+                    --level;
+                }
+            }
+
+            bandwidth_ = bandwidth;
+            demand_ = demand;
+            level_.store(level, std::memory_order_relaxed);
+        }
+
+        // the level is read by every chunk of every loop, it is kept apart
+        // from the counters written by the workers
+        char pad0_[128];
+        std::atomic<unsigned> level_;
+        std::uint64_t window_ticks_;
+        double high_watermark_;
+        double low_watermark_;
+        char pad1_[128];
+
+        // the bytes retired and the bytes requested ahead (times ticks) in
+        // the current window
+        std::atomic<std::size_t> bytes_;
+        std::atomic<std::uint64_t> demand_ticks_;
+        std::atomic<std::uint64_t> start_;
+        char pad2_[128];
+
+        // the state of the windows, updated by the worker closing a window
+        struct level_change
+        {
+            double demand;
+            double bandwidth;
+        };
+
+        mutable std::mutex mtx_;
+        // the bandwidth and the demand of the last window
+        double bandwidth_;
+        double demand_;
+        // the demand before and the bandwidth after each raise of the level
+        level_change raised_[max_level];
+        double peak_;
+        std::size_t windows_;
+        std::size_t saturated_windows_;
+    };
+
+    // The throttle shared by all loops running in the given NUMA domain,
+    // created on first use.
+    inline bandwidth_throttle& get_bandwidth_throttle(std::size_t domain)
+    {
+        static std::mutex mtx;
+        static std::deque<bandwidth_throttle> throttles;
+
+        std::lock_guard<std::mutex> l(mtx);
+        while (throttles.size() <= domain)
+            throttles.emplace_back();
+        return throttles[domain];
+    }
+
+    // The throttle of the NUMA domain the calling worker thread runs in,
+    // threads which aren't HPX worker threads use the one of domain 0.
+    inline bandwidth_throttle& get_worker_bandwidth_throttle()
+    {
+        std::size_t const worker = hpx::get_worker_thread_num();
+        if (worker == std::size_t(-1))
+            return get_bandwidth_throttle(0);
+
+        return get_bandwidth_throttle(
+            threads::get_topology().get_numa_node_number(worker));
+    }
+
+    namespace detail
+    {
+        // The throttle of the loop the calling worker thread is running,
+        // if the loop is throttled.
+        inline bandwidth_throttle*& current_bandwidth_throttle()
+        {
+            static thread_local bandwidth_throttle* throttle = nullptr;
+            return throttle;
+        }
+    }
+}}}
+
+#endif
@@ -0,0 +1,231 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_CACHE_TOPOLOGY_HPP)
+#define HPX_PARALLEL_UTIL_CACHE_TOPOLOGY_HPP
+
+#include <hpx/config.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define HPX_PARALLEL_UTIL_HAVE_CPUID
+#endif
+
+// The cache line size assumed by the compile-time specialized prefetchers
+// (see make_static_prefetcher_context).
+#if !defined(HPX_PREFETCH_LINE_SIZE)
+#define HPX_PREFETCH_LINE_SIZE 64
+#endif
+
+namespace hpx { namespace parallel { namespace util
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // The properties of the data caches of the machine which are relevant
+    // for prefetching.
+    struct cache_topology
+    {
+        // size of a cache line of the L1 data cache
+        std::size_t line_size;
+        // number of bytes brought in by a single prefetch, this is twice the
+        // line size on machines which prefetch adjacent lines in pairs
+        std::size_t prefetch_granularity;
+        std::size_t l1_size;
+        std::size_t l2_size;
+        // size of the last level cache, shared by the cores of a socket
+        // (the L2 cache on machines without a third level)
+        std::size_t llc_size;
+    };
+
+    namespace detail
+    {
+        ///////////////////////////////////////////////////////////////////////
+        // parse sizes like "32K" as reported by sysfs
+        inline std::size_t parse_cache_size(std::string const& s)
+        {
+            std::size_t pos = 0;
+            std::size_t value = 0;
+            for (/**/; pos != s.size() && s[pos] >= '0' && s[pos] <= '9'; ++pos)
+                value = value * 10 + std::size_t(s[pos] - '0');
+
+            if (pos != s.size())
+            {
+                if (s[pos] == 'K')
+                    value *= 1024;
+                else if (s[pos] == 'M')
+                    value *= 1024 * 1024;
+            }
+            return value;
+        }
+
+        inline bool read_sysfs_entry(std::string const& path, std::string& s)
+        {
+            std::ifstream in(path.c_str());
+            return static_cast<bool>(in >> s);
+        }
+
+        // Read the data (or unified) caches of level 1, 2 and of the last
+        // level of the first core from /sys/devices/system/cpu/cpu0/cache/
+        // index*.
+        inline bool discover_cache_topology_sysfs(cache_topology& t)
+        {
+            bool found = false;
+            int last_level = 0;
+            for (int i = 0; i != 8; ++i)
+            {
+                std::string const dir =
+                    "/sys/devices/system/cpu/cpu0/cache/index" +
+                    std::to_string(i) + "/";
+
+                std::string level, type, size, line;
+                if (!read_sysfs_entry(dir + "level", level) ||
+                    !read_sysfs_entry(dir + "type", type))
+                {
+                    break;
+                }
+                if (type == "Instruction")
+                    continue;
+
+                read_sysfs_entry(dir + "size", size);
+                read_sysfs_entry(dir + "coherency_line_size", line);
+
+                if (level == "1")
+                {
+                    t.l1_size = parse_cache_size(size);
+                    t.line_size = parse_cache_size(line);
+                    found = true;
+                }
+                else if (level == "2")
+                {
+                    t.l2_size = parse_cache_size(size);
+                }
+
+                int const l = std::atoi(level.c_str());
+                if (l >= 2 && l > last_level)
+                {
+                    last_level = l;
+                    t.llc_size = parse_cache_size(size);
+                }
+            }
+            return found && t.line_size != 0;
+        }
+
+#if defined(HPX_PARALLEL_UTIL_HAVE_CPUID)
+        // Use the deterministic cache parameters (leaf 4) reported by cpuid.
+        inline bool discover_cache_topology_cpuid(cache_topology& t)
+        {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx) || eax < 4)
+                return false;
+
+            bool found = false;
+            unsigned int last_level = 0;
+            for (unsigned int i = 0; i != 8; ++i)
+            {
+                __cpuid_count(4, i, eax, ebx, ecx, edx);
+
+                unsigned int const type = eax & 0x1f;
+                if (type == 0)
+                    break;
+                if (type == 2)      // instruction cache
+                    continue;
+
+                unsigned int const level = (eax >> 5) & 0x7;
+                std::size_t const line = (ebx & 0xfff) + 1;
+                std::size_t const size = (((ebx >> 22) & 0x3ff) + 1) *
+                    (((ebx >> 12) & 0x3ff) + 1) * line * (ecx + 1);
+
+                if (level == 1)
+                {
+                    t.l1_size = size;
+                    t.line_size = line;
+                    found = true;
+                }
+                else if (level == 2)
+                {
+                    t.l2_size = size;
+                }
+
+                if (level >= 2 && level > last_level)
+                {
+                    last_level = level;
+                    t.llc_size = size;
+                }
+            }
+            return found;
+        }
+#endif
+
+        inline cache_topology discover_cache_topology()
+        {
+            cache_topology t = { 0, 0, 0, 0, 0 };
+
+            bool found = discover_cache_topology_sysfs(t);
+#if defined(HPX_PARALLEL_UTIL_HAVE_CPUID)
+            if (!found)
+                found = discover_cache_topology_cpuid(t);
+#endif
+#if defined(_SC_LEVEL1_DCACHE_LINESIZE)
+            if (!found)
+            {
+                long const line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+                long const l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+                long const l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+                long const l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+                if (line > 0)
+                {
+                    t.line_size = std::size_t(line);
+                    t.l1_size = l1 > 0 ? std::size_t(l1) : 0;
+                    t.l2_size = l2 > 0 ? std::size_t(l2) : 0;
+                    t.llc_size = l3 > 0 ? std::size_t(l3) : 0;
+                }
+            }
+#endif
+            // the line size has to be a power of two for the address
+            // computations of the prefetchers
+            if (t.line_size == 0 || (t.line_size & (t.line_size - 1)) != 0)
+                t.line_size = 64;
+            if (t.l1_size == 0)
+                t.l1_size = 32 * 1024;
+            if (t.l2_size == 0)
+                t.l2_size = 256 * 1024;
+            if (t.llc_size < t.l2_size)
+                t.llc_size = t.l2_size;
+
+            // the effective prefetch granularity can't be detected reliably
+            // (adjacent line prefetching is a model specific setting), it
+            // can be given through the environment
+            t.prefetch_granularity = t.line_size;
+            if (char const* g = std::getenv("HPX_PREFETCH_GRANULARITY"))
+            {
+                std::size_t const granularity = parse_cache_size(g);
+                if (granularity >= t.line_size &&
+                    (granularity & (granularity - 1)) == 0)
+                {
+                    t.prefetch_granularity = granularity;
+                }
+            }
+            return t;
+        }
+    }
+
+    // The cache topology is discovered once per process.
+    inline cache_topology const& get_cache_topology()
+    {
+        static cache_topology const topology =
+            detail::discover_cache_topology();
+        return topology;
+    }
+}}}
+
+#endif
@@ -54,8 +54,10 @@ namespace hpx { namespace parallel { HPX_INLINE_NAMESPACE(v1)
             sequential(ExPolicy, Iter first, std::size_t count, F && f,
                 Proj && proj = Proj())
             {
+                typedef typename util::loop_n_iterator_mapping<Iter>::type
+                    iterator_type;
                 return util::loop_n(first, count,
-                    [&f, &proj](Iter curr)
+                    [&f, &proj](iterator_type curr)
                     {
                         hpx::util::invoke(f, hpx::util::invoke(proj, *curr));
                     });
@@ -227,15 +229,21 @@ namespace hpx { namespace parallel { HPX_INLINE_NAMESPACE(v1)
             sequential(ExPolicy, InIter first, InIter last, F && f,
                 Proj && proj)
             {
+                typedef typename util::loop_n_iterator_mapping<Iter>::type
+                    iterator_type;
                 return util::loop(first, last,
-                    [&f, &proj](Iter curr)
+                    [&f, &proj](iterator_type curr)
                     {
                         f(hpx::util::invoke(proj, *curr));
                     });
             }
 
+            // prefetching iterators have to go through util::loop to run
+            // their prefetching schedule
             template <typename ExPolicy, typename InIter, typename F>
-            static InIter
+            static typename std::enable_if<
+                !util::is_prefetching_iterator<InIter>::value, InIter
+            >::type
             sequential(ExPolicy, InIter first, InIter last, F && f,
                 util::projection_identity)
             {
@@ -394,6 +402,220 @@ namespace hpx { namespace parallel { HPX_INLINE_NAMESPACE(v1)
             std::forward<ExPolicy>(policy), first, last,
             std::forward<F>(f), std::forward<Proj>(proj), is_segmented());
     }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // for_each (chunk-wise, prefetching iterators only)
+    namespace detail
+    {
+        /// \cond NOINTERNAL
+        template <typename Iter>
+        struct for_each_chunk
+          : public detail::algorithm<for_each_chunk<Iter>, Iter>
+        {
+            for_each_chunk()
+              : for_each_chunk::algorithm("for_each_chunk")
+            {}
+
+            template <typename ExPolicy, typename F>
+            static Iter
+            sequential(ExPolicy, Iter first, std::size_t count, F && f)
+            {
+                return util::loop_chunks_n(first, count, std::forward<F>(f));
+            }
+
+            template <typename ExPolicy, typename F>
+            static typename util::detail::algorithm_result<ExPolicy, Iter>::type
+            parallel(ExPolicy && policy, Iter first, std::size_t count,
+                F && f)
+            {
+                if (count != 0)
+                {
+                    return util::foreach_partitioner<ExPolicy>::call(
+                        std::forward<ExPolicy>(policy), first, count,
+                        [f](std::size_t /*part_index*/,
+                            Iter part_begin, std::size_t part_size) mutable
+                        {
+                            util::loop_chunks_n(part_begin, part_size, f);
+                        });
+                }
+
+                return util::detail::algorithm_result<ExPolicy, Iter>::get(
+                    std::move(first));
+            }
+        };
+        /// \endcond
+    }
+
+    /// Applies \a f to each chunk of the range [first, last) of prefetching
+    /// iterators. Instead of being invoked once per element, \a f is invoked
+    /// once per chunk with the positions [chunk_first, chunk_last) of the
+    /// chunk's elements in the base range of the prefetcher context. The
+    /// prefetches for the chunk which is prefetch_distance chunks ahead are
+    /// issued before \a f is invoked, which allows the loop inside \a f to
+    /// be vectorized and unrolled by the compiler.
+    ///
+    /// \note   Complexity: Applies \a f exactly \a last - \a first times.
+    ///
+    /// \tparam ExPolicy    The type of the execution policy to use (deduced).
+    /// \tparam InIter      The type of the prefetching iterators used
+    ///                     (deduced).
+    /// \tparam F           The type of the function/function object to use
+    ///                     (deduced). \a F has to be invocable as
+    ///                     \code
+    ///                     <ignored> f(std::size_t chunk_first,
+    ///                         std::size_t chunk_last);
+    ///                     \endcode
+    ///
+    /// \param policy       The execution policy to use for the scheduling of
+    ///                     the iterations.
+    /// \param first        Refers to the first chunk of the prefetcher
+    ///                     context.
+    /// \param last         Refers to the end of the chunks of the prefetcher
+    ///                     context.
+    /// \param f            Specifies the function (or function object) which
+    ///                     will be invoked for each of the chunks.
+    ///
+    /// \returns  The chunk-wise \a for_each algorithm returns a
+    ///           \a hpx::future<InIter> if the execution policy is of
+    ///           type
+    ///           \a sequential_task_execution_policy or
+    ///           \a parallel_task_execution_policy and returns \a InIter
+    ///           otherwise.
+    ///
+    template <typename ExPolicy, typename InIter, typename F,
+    HPX_CONCEPT_REQUIRES_(
+        is_execution_policy<ExPolicy>::value &&
+        util::is_prefetching_iterator<InIter>::value &&
+        hpx::traits::is_callable<F(std::size_t, std::size_t)>::value)>
+    typename util::detail::algorithm_result<ExPolicy, InIter>::type
+    for_each(ExPolicy && policy, InIter first, InIter last, F && f)
+    {
+        typedef is_sequential_execution_policy<ExPolicy> is_seq;
+
+        if (first == last)
+        {
+            typedef util::detail::algorithm_result<ExPolicy, InIter> result;
+            return result::get(std::move(last));
+        }
+
+        return detail::for_each_chunk<InIter>().call(
+            std::forward<ExPolicy>(policy), is_seq(),
+            first, std::size_t(last - first), std::forward<F>(f));
+    }
+
+#if defined(HPX_HAVE_CXX20_COROUTINES)
+    ///////////////////////////////////////////////////////////////////////////
+    // for_each_interleaved
+    namespace detail
+    {
+        /// \cond NOINTERNAL
+        template <typename Iter>
+        struct for_each_interleaved
+          : public detail::algorithm<for_each_interleaved<Iter>, Iter>
+        {
+            for_each_interleaved()
+              : for_each_interleaved::algorithm("for_each_interleaved")
+            {}
+
+            template <typename ExPolicy, typename F>
+            static Iter
+            sequential(ExPolicy, Iter first, std::size_t count,
+                std::size_t width, F && f)
+            {
+                return util::loop_interleaved_n(first, count, width,
+                    std::forward<F>(f));
+            }
+
+            template <typename ExPolicy, typename F>
+            static typename util::detail::algorithm_result<ExPolicy, Iter>::type
+            parallel(ExPolicy && policy, Iter first, std::size_t count,
+                std::size_t width, F && f)
+            {
+                if (count != 0)
+                {
+                    return util::foreach_partitioner<ExPolicy>::call(
+                        std::forward<ExPolicy>(policy), first, count,
+                        [f, width](std::size_t /*part_index*/,
+                            Iter part_begin, std::size_t part_size) mutable
+                        {
+                            util::loop_interleaved_n(part_begin, part_size,
+                                width, f);
+                        });
+                }
+
+                return util::detail::algorithm_result<ExPolicy, Iter>::get(
+                    std::move(first));
+            }
+        };
+        /// \endcond
+    }
+
+    /// Applies the coroutine \a f to the result of dereferencing every
+    /// iterator in the range [first, last), interleaving the execution of up
+    /// to \a width coroutines on each of the executing threads. Whenever a
+    /// coroutine issues a prefetch by co_awaiting
+    /// \a util::prefetch_and_switch, the next one is resumed, which overlaps
+    /// the cache misses of up to \a width independent chains of dependent
+    /// loads (e.g. lookups in hash tables, trees or linked lists).
+    ///
+    /// \note   Complexity: Applies \a f exactly \a last - \a first times.
+    ///
+    /// \tparam ExPolicy    The type of the execution policy to use (deduced).
+    /// \tparam FwdIter     The type of the source iterators used (deduced).
+    ///                     This iterator type must meet the requirements of a
+    ///                     forward iterator.
+    /// \tparam F           The type of the coroutine to use (deduced). \a F
+    ///                     has to be invocable as
+    ///                     \code
+    ///                     util::prefetch_task f(Type a);
+    ///                     \endcode \n
+    ///                     The argument should be taken by value, as the
+    ///                     coroutine outlives the iteration step which
+    ///                     created it.
+    ///
+    /// \param policy       The execution policy to use for the scheduling of
+    ///                     the iterations.
+    /// \param first        Refers to the beginning of the sequence of elements
+    ///                     the algorithm will be applied to.
+    /// \param last         Refers to the end of the sequence of elements the
+    ///                     algorithm will be applied to.
+    /// \param width        The number of coroutines which are kept in flight
+    ///                     by each of the executing threads.
+    /// \param f            Specifies the coroutine which will be invoked for
+    ///                     each of the elements in the sequence specified by
+    ///                     [first, last).
+    ///
+    /// \returns  The \a for_each_interleaved algorithm returns a
+    ///           \a hpx::future<FwdIter> if the execution policy is of
+    ///           type
+    ///           \a sequential_task_execution_policy or
+    ///           \a parallel_task_execution_policy and returns \a FwdIter
+    ///           otherwise.
+    ///
+    template <typename ExPolicy, typename FwdIter, typename F,
+    HPX_CONCEPT_REQUIRES_(
+        is_execution_policy<ExPolicy>::value &&
+        hpx::traits::is_iterator<FwdIter>::value)>
+    typename util::detail::algorithm_result<ExPolicy, FwdIter>::type
+    for_each_interleaved(ExPolicy && policy, FwdIter first, FwdIter last,
+        std::size_t width, F && f)
+    {
+        typedef typename std::iterator_traits<FwdIter>::iterator_category
+            iterator_category;
+
+        static_assert(
+            (boost::is_base_of<
+                std::forward_iterator_tag, iterator_category>::value),
+            "Requires at least forward iterator.");
+
+        typedef is_sequential_execution_policy<ExPolicy> is_seq;
+
+        return detail::for_each_interleaved<FwdIter>().call(
+            std::forward<ExPolicy>(policy), is_seq(),
+            first, std::size_t(std::distance(first, last)), width,
+            std::forward<F>(f));
+    }
+#endif
 }}}
 
 #endif
@@ -136,18 +136,18 @@ void test_for_each_with_prefetching_test()
 {
     using namespace hpx::parallel;
 
-    //test_for_each_with_prefetching(seq, IteratorTag()); //loop_n is not called for seq policy
+    test_for_each_with_prefetching(seq, IteratorTag());
     test_for_each_with_prefetching(par, IteratorTag());
     test_for_each_with_prefetching(par_vec, IteratorTag());
 
-    //test_for_each_with_prefetching_async(seq(task), IteratorTag());
+    test_for_each_with_prefetching_async(seq(task), IteratorTag());
     test_for_each_with_prefetching_async(par(task), IteratorTag());
 
-    //test_for_each_with_prefetching(execution_policy(seq), IteratorTag());
+    test_for_each_with_prefetching(execution_policy(seq), IteratorTag());
     test_for_each_with_prefetching(execution_policy(par), IteratorTag());
     test_for_each_with_prefetching(execution_policy(par_vec), IteratorTag());
 
-    //test_for_each_with_prefetching(execution_policy(seq(task)), IteratorTag());
+    test_for_each_with_prefetching(execution_policy(seq(task)), IteratorTag());
     test_for_each_with_prefetching(execution_policy(par(task)), IteratorTag());
 }
 
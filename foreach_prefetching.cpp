@@ -17,11 +17,59 @@ void test_for_each_prefetching()
 {
     using namespace hpx::parallel;
 
+    test_for_each_prefetching(seq, IteratorTag());
     test_for_each_prefetching(par, IteratorTag());
     test_for_each_prefetching(par_vec, IteratorTag());
+    test_for_each_prefetching_async(seq(task), IteratorTag());
     test_for_each_prefetching_async(par(task), IteratorTag());
+    test_for_each_prefetching_mixed(par, IteratorTag());
+    test_for_each_prefetching_subrange(seq, IteratorTag());
+    test_for_each_prefetching_subrange(par, IteratorTag());
+    test_for_each_prefetching_lines(seq, IteratorTag());
+    test_for_each_prefetching_lines(par, IteratorTag());
+    test_for_each_prefetching_hints(seq, IteratorTag());
+    test_for_each_prefetching_hints(par, IteratorTag());
+    test_for_each_prefetching_indirect(par, IteratorTag());
+    test_for_each_prefetching_strided(seq, IteratorTag());
+    test_for_each_prefetching_strided(par, IteratorTag());
+    test_for_each_prefetching_chunks(seq, IteratorTag());
+    test_for_each_prefetching_chunks(par, IteratorTag());
+    test_for_each_prefetching_chunks(par_vec, IteratorTag());
+    test_for_each_prefetching_adaptive(seq, IteratorTag());
+    test_for_each_prefetching_adaptive(par, IteratorTag());
+    test_for_each_prefetching_calibrated(seq, IteratorTag());
+    test_for_each_prefetching_calibrated(par, IteratorTag());
+    test_for_each_prefetching_footprint(par, IteratorTag());
+    test_for_each_prefetching_static(seq, IteratorTag());
+    test_for_each_prefetching_static(par, IteratorTag());
+    test_for_each_prefetching_aligned(par, IteratorTag());
+    test_for_each_prefetching_helper(seq, IteratorTag());
+    test_for_each_prefetching_helper(par, IteratorTag());
+    test_for_each_prefetching_inspect(seq, IteratorTag());
+    test_for_each_prefetching_inspect(par, IteratorTag());
+    test_for_each_prefetching_limited(par, IteratorTag());
+    test_for_each_prefetching_two_level(seq, IteratorTag());
+    test_for_each_prefetching_two_level(par, IteratorTag());
+    test_for_each_prefetching_pages(seq, IteratorTag());
+    test_for_each_prefetching_pages(par, IteratorTag());
+    test_for_each_prefetching_bypass(par, IteratorTag());
+    test_for_each_prefetching_throttle(seq, IteratorTag());
+    test_for_each_prefetching_throttle(par, IteratorTag());
+    test_for_each_prefetching_budget(seq, IteratorTag());
+    test_for_each_prefetching_budget(par, IteratorTag());
+    test_for_each_prefetching_jump_pointers(seq, IteratorTag());
+    test_for_each_prefetching_jump_pointers(par, IteratorTag());
+    test_loop_idx_n_prefetching(IteratorTag());
+    test_loop_with_cleanup_prefetching(IteratorTag());
+    test_loop_cancellation_prefetching(IteratorTag());
+    test_accumulate_n_prefetching(IteratorTag());
+#if defined(HPX_HAVE_CXX20_COROUTINES)
+    test_for_each_interleaved(seq, IteratorTag());
+    test_for_each_interleaved(par, IteratorTag());
+#endif
 
 #if defined(HPX_HAVE_GENERIC_EXECUTION_POLICY)
+    test_for_each_prefetching(execution_policy(seq), IteratorTag());
     test_for_each_prefetching(execution_policy(par), IteratorTag());
     test_for_each_prefetching(execution_policy(par_vec), IteratorTag());
     test_for_each_prefetching(execution_policy(par(task)), IteratorTag());
@@ -7,11 +7,19 @@
 #define HPX_PARALLEL_TEST_FOREACH_MAY24_16
 
 #include <hpx/include/parallel_for_each.hpp>
+#include <hpx/parallel/util/jump_pointer_table.hpp>
 #include <hpx/util/lightweight_test.hpp>
 
 #include <boost/range/functions.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <list>
 #include <numeric>
+#include <random>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "test_utils.hpp"
@@ -75,6 +83,1238 @@ void test_for_each_prefetching_async(ExPolicy && p, IteratorTag)
     HPX_TEST_EQ(count, c.size());
 }
 
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_mixed(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    struct particle { double r[3]; double m; };
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(10007, 1.0);
+    std::vector<float> f(10007, 1.0f);
+    std::vector<std::int32_t> idx(10007, 1);
+    std::vector<particle> p(10007);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c, f, idx, p);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            c[i] = 42.0;
+            f[i] = 42.0f;
+            idx[i] = 42;
+            p[i].m = 42.0;
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+    {
+        HPX_TEST_EQ(c[i], 42.0);
+        HPX_TEST_EQ(f[i], 42.0f);
+        HPX_TEST_EQ(idx[i], 42);
+        HPX_TEST_EQ(p[i].m, 42.0);
+    }
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_subrange(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    typedef hpx::parallel::util::detail::prefetching_iterator<double> base_iterator;
+    static_assert(std::is_trivially_copyable<base_iterator>::value,
+        "prefetching iterators should be trivially copyable");
+
+    // the iteration neither starts at zero nor covers a whole number of
+    // cache lines
+    std::size_t const idx_begin = 13;
+    std::size_t const idx_end = 10007 - 5;
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> c(10007, 1.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (idx_begin,idx_end,{c.data()},prefetch_distance_factor);
+
+    // iterators are cheap handles referring to the context
+    base_iterator first = ctx.begin();
+    base_iterator it = first;
+    it += 3;
+    HPX_TEST_EQ(it - first, std::ptrdiff_t(3));
+    HPX_TEST(first + 3 == it);
+    HPX_TEST(it - 3 == first);
+    HPX_TEST(std::size_t(ctx.end() - ctx.begin()) * ctx.chunk_size >=
+        idx_end - idx_begin);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            c[i] = 42.0;
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != c.size(); ++i)
+    {
+        if (i < idx_begin || i >= idx_end)
+            HPX_TEST_EQ(c[i], 1.0);
+        else
+            HPX_TEST_EQ(c[i], 42.0);
+    }
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_lines(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    // the prefetches are spread over the lines of each chunk, the last
+    // line of a chunk (and the last chunk) may be partial
+    std::size_t const sizes[] = { 1, 7, 8, 9, 63, 1001, 10007 };
+    for (std::size_t size: sizes)
+    {
+        for (std::size_t factor = 1; factor != 4; ++factor)
+        {
+            std::vector<std::size_t> range(size);
+            std::iota(boost::begin(range), boost::end(range), 0);
+
+            std::vector<std::size_t> visits(size, 0);
+            std::vector<char> flags(size, 0);
+
+            auto ctx = hpx::parallel::util::make_prefetcher_context(
+                range.begin(), range.end(), factor, visits, flags);
+            ctx.prefetch_distance = 2;
+
+            hpx::parallel::for_each(policy, ctx.begin(), ctx.end(),
+                [&](std::size_t i) {
+                    ++visits[i];
+                    flags[i] = 1;
+                });
+
+            // verify values
+            for (std::size_t i = 0; i != size; ++i)
+            {
+                HPX_TEST_EQ(visits[i], std::size_t(1));
+                HPX_TEST_EQ(flags[i], 1);
+            }
+        }
+    }
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_hints(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    using hpx::parallel::util::prefetch_hint;
+    using hpx::parallel::util::make_prefetch_container;
+
+    prefetch_hint const hints[] = {
+        prefetch_hint::t0, prefetch_hint::t1, prefetch_hint::t2,
+        prefetch_hint::nta, prefetch_hint::write, prefetch_hint::touch,
+        prefetch_hint::none
+    };
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    for (prefetch_hint hint: hints)
+    {
+        std::vector<double> a(10007, 0.0);
+        std::vector<double> b(10007, 1.0);
+
+        auto ctx = hpx::parallel::util::make_prefetcher_context(
+            range.begin(), range.end(), prefetch_distance_factor,
+            make_prefetch_container(a, hint),
+            make_prefetch_container(b, hint));
+        ctx.prefetch_distance = 4;
+
+        // containers which are not prefetched have no footprint, which
+        // leaves the distance unlimited
+        if (hint == prefetch_hint::none)
+            HPX_TEST_EQ(ctx.max_prefetch_distance, std::size_t(-1));
+        else
+            HPX_TEST(ctx.max_prefetch_distance != std::size_t(-1));
+
+        hpx::parallel::for_each(policy, ctx.begin(), ctx.end(),
+            [&](std::size_t i) {
+                a[i] = b[i] + 41.0;
+            });
+
+        // verify values
+        for (std::size_t i = 0; i != range.size(); ++i)
+            HPX_TEST_EQ(a[i], 42.0);
+    }
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_indirect(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    // gather through a random permutation of the indices
+    std::vector<std::int32_t> idx(10007);
+    std::iota(boost::begin(idx), boost::end(idx), 0);
+    std::shuffle(boost::begin(idx), boost::end(idx), std::mt19937(42));
+
+    std::vector<double> x(10007, 1.0);
+    std::vector<double> y(10007, 0.0);
+
+    auto ctx = hpx::parallel::util::make_indirect_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, idx, x, y);
+    ctx.prefetch_distance = 4;
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            y[idx[i]] = x[idx[i]] + 41.0;
+        });
+
+    // verify values
+    std::size_t count = 0;
+    std::for_each(boost::begin(y), boost::end(y),
+        [&count](double v) -> void {
+            HPX_TEST_EQ(v, 42.0);
+            ++count;
+        });
+    HPX_TEST_EQ(count, y.size());
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_strided(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    using hpx::parallel::util::make_strided_prefetch_container;
+
+    std::size_t prefetch_distance_factor = 2;
+    std::size_t const size = 10007;
+    std::vector<std::size_t> range(size);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    // element i uses the fields [offset, offset + width) of the i-th record
+    // of stride fields, once with several and once with less than one
+    // record per cache line
+    std::size_t const stride_a = 5, offset_a = 1, width_a = 3;
+    std::size_t const stride_b = 17, offset_b = 3, width_b = 2;
+    std::vector<std::size_t> a(stride_a * size, 0);
+    std::vector<std::size_t> b(stride_b * size, 0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor,
+        make_strided_prefetch_container(a, stride_a, offset_a, width_a),
+        make_strided_prefetch_container(b, stride_b, offset_b, width_b));
+    ctx.prefetch_distance = 4;
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            for (std::size_t k = 0; k != width_a; ++k)
+                ++a[stride_a * i + offset_a + k];
+            for (std::size_t k = 0; k != width_b; ++k)
+                ++b[stride_b * i + offset_b + k];
+        });
+
+    // verify values, the fields outside of [offset, offset + width) are
+    // not touched
+    for (std::size_t j = 0; j != a.size(); ++j)
+    {
+        std::size_t const field = j % stride_a;
+        bool const used = field >= offset_a && field < offset_a + width_a;
+        HPX_TEST_EQ(a[j], std::size_t(used ? 1 : 0));
+    }
+    for (std::size_t j = 0; j != b.size(); ++j)
+    {
+        std::size_t const field = j % stride_b;
+        bool const used = field >= offset_b && field < offset_b + width_b;
+        HPX_TEST_EQ(b[j], std::size_t(used ? 1 : 0));
+    }
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_chunks(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> a(10007, 0.0);
+    std::vector<double> b(10007, 1.0);
+    std::vector<double> c(10007, 2.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,10007,{a.data(),b.data(),c.data()},prefetch_distance_factor);
+
+    std::atomic<std::size_t> calls(0);
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t first, std::size_t last) {
+            HPX_TEST(first < last);
+            HPX_TEST(last - first <= ctx.chunk_size);
+            for (std::size_t i = first; i != last; ++i)
+                a[i] = b[i] + 20.0 * c[i];
+            ++calls;
+        });
+
+    HPX_TEST_EQ(calls.load(), std::size_t(ctx.end() - ctx.begin()));
+
+    // verify values
+    std::size_t count = 0;
+    std::for_each(boost::begin(a), boost::end(a),
+        [&count](double v) -> void {
+            HPX_TEST_EQ(v, 41.0);
+            ++count;
+        });
+    HPX_TEST_EQ(count, a.size());
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_adaptive(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> c(100007, 0.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,100007,{c.data()},prefetch_distance_factor);
+    ctx.enable_adaptive_distance(8);
+
+    // the learned distance is carried over between the invocations
+    for (int iteration = 0; iteration != 3; ++iteration)
+    {
+        hpx::parallel::for_each(policy,
+            ctx.begin(), ctx.end(),
+            [&](std::size_t i) { c[i] += 14.0; });
+
+        HPX_TEST(ctx.learned_distance() >= 1);
+        HPX_TEST(ctx.learned_distance() <= 8);
+    }
+
+    // verify values
+    std::size_t count = 0;
+    std::for_each(boost::begin(c), boost::end(c),
+        [&count](double v) -> void {
+            HPX_TEST_EQ(v, 42.0);
+            ++count;
+        });
+    HPX_TEST_EQ(count, c.size());
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_calibrated(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    // the memory latency is measured once, before any of the loops runs
+    std::size_t const latency = hpx::parallel::util::calibrate_prefetcher();
+    HPX_TEST(latency != 0);
+    HPX_TEST_EQ(hpx::parallel::util::calibrate_prefetcher(), latency);
+    HPX_TEST_EQ(hpx::parallel::util::detail::memory_latency(), latency);
+
+    // a prefetcher_distance_factor of zero calibrates the distance
+    std::vector<double> c(100007, 0.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,100007,{c.data()},0);
+    HPX_TEST_EQ(ctx.learned_distance(), std::size_t(0));
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) { c[i] = 42.0; });
+
+    HPX_TEST(ctx.learned_distance() >= 1);
+    HPX_TEST(ctx.learned_distance() <=
+        hpx::parallel::util::detail::max_calibrated_distance);
+
+    // verify values
+    std::size_t count = 0;
+    std::for_each(boost::begin(c), boost::end(c),
+        [&count](double v) -> void {
+            HPX_TEST_EQ(v, 42.0);
+            ++count;
+        });
+    HPX_TEST_EQ(count, c.size());
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_footprint(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    hpx::parallel::util::cache_topology const& topo =
+        hpx::parallel::util::get_cache_topology();
+    HPX_TEST(topo.line_size != 0);
+    HPX_TEST(topo.prefetch_granularity >= topo.line_size);
+    HPX_TEST(topo.llc_size >= topo.l2_size);
+
+    // the chunks and the prefetches in flight are limited to the caches
+    std::size_t prefetch_distance_factor = 100000;
+    std::vector<double> a(100007, 0.0);
+    std::vector<double> b(100007, 1.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,100007,{a.data(),b.data()},prefetch_distance_factor);
+    ctx.prefetch_distance = 100000;
+
+    HPX_TEST(2 * ctx.chunk_size * sizeof(double) <= topo.l1_size / 2);
+    HPX_TEST(ctx.learned_distance() <= ctx.max_prefetch_distance);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) { a[i] = b[i] + 41.0; });
+
+    // verify values
+    std::size_t count = 0;
+    std::for_each(boost::begin(a), boost::end(a),
+        [&count](double v) -> void {
+            HPX_TEST_EQ(v, 42.0);
+            ++count;
+        });
+    HPX_TEST_EQ(count, a.size());
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_static(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> a(10007, 0.0);
+    std::vector<double> b(10007, 1.0);
+    std::vector<float> c(10007, 2.0f);
+
+    // distance of 4 chunks, chunks of 2 cache lines
+    auto ctx = hpx::parallel::util::make_static_prefetcher_context<4, 2>(
+        range.begin(), range.end(), a, b, c);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            a[i] = b[i] + 20.0 * c[i];
+        });
+
+    // verify values
+    std::size_t count = 0;
+    std::for_each(boost::begin(a), boost::end(a),
+        [&count](double v) -> void {
+            HPX_TEST_EQ(v, 41.0);
+            ++count;
+        });
+    HPX_TEST_EQ(count, a.size());
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_aligned(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t const line_size =
+        hpx::parallel::util::get_cache_topology().prefetch_granularity;
+
+    // the primary container does not start on a cache-line boundary
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> buffer(10007 + 16, 0.0);
+    double* a = buffer.data() + 1;
+    if (reinterpret_cast<std::uintptr_t>(a) % line_size == 0)
+        ++a;
+
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,10007,{a},prefetch_distance_factor);
+    HPX_TEST(ctx.chunk_offset != 0);
+
+    // all chunks but the first one start on a cache-line boundary
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t first, std::size_t last) {
+            if (first != 0)
+            {
+                HPX_TEST_EQ(
+                    reinterpret_cast<std::uintptr_t>(a + first) % line_size,
+                    std::uintptr_t(0));
+            }
+            for (std::size_t i = first; i != last; ++i)
+                a[i] = 42.0;
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != 10007; ++i)
+        HPX_TEST_EQ(a[i], 42.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_helper(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(10007, 1.0);
+    std::vector<double> d(10007, 0.0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c, d);
+    ctx.prefetch_distance = 8;
+    ctx.enable_helper_thread();
+
+    // workers without a free SMT sibling prefetch by themselves, the results
+    // are the same either way
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            d[i] = 2.0 * c[i];
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(d[i], 2.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_inspect(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    using hpx::parallel::util::record_access;
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    // an irregular gather which is not described to the context
+    std::vector<double> x(100003, 1.0);
+    std::vector<std::size_t> neighbors(4 * range.size());
+    std::mt19937 gen(42);
+    for (std::size_t& n: neighbors)
+        n = gen() % x.size();
+
+    std::vector<double> y(10007, 0.0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, y);
+    ctx.prefetch_distance = 4;
+
+    hpx::parallel::util::prefetch_schedule schedule;
+    ctx.inspect(schedule);
+
+    // the first pass records the schedule, the following ones replay it,
+    // the last one using a different hint
+    for (int pass = 0; pass != 3; ++pass)
+    {
+        if (pass == 2)
+        {
+            ctx.inspect(schedule, hpx::parallel::util::prefetch_hint::nta);
+            HPX_TEST(schedule.recorded(0));
+        }
+
+        hpx::parallel::for_each(policy,
+            ctx.begin(), ctx.end(),
+            [&](std::size_t i) {
+                double sum = 0.0;
+                for (std::size_t j = 4 * i; j != 4 * i + 4; ++j)
+                    sum += record_access(x[neighbors[j]]);
+                y[i] += sum;
+            });
+
+        for (std::size_t k = 0; k != schedule.size(); ++k)
+            HPX_TEST(schedule.recorded(k));
+    }
+
+    // the lines of the accesses of the first chunk are replayed
+    std::size_t replayed = 0;
+    schedule.replay(0, [&](void const*) { ++replayed; });
+    HPX_TEST(replayed != 0);
+    HPX_TEST_EQ(replayed, schedule.lines(0));
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(y[i], 12.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The loop helpers are run over the partitions of the range, as done by the
+// parallel algorithms
+template <typename Iter>
+std::vector<std::pair<Iter, std::size_t> >
+make_partitions(Iter first, Iter last, std::size_t parts)
+{
+    std::vector<std::pair<Iter, std::size_t> > partitions;
+    std::size_t const count = std::size_t(last - first);
+    for (std::size_t k = 0; k != parts; ++k)
+    {
+        std::size_t const begin = k * count / parts;
+        std::size_t const end = (k + 1) * count / parts;
+        partitions.push_back(std::make_pair(first + begin, end - begin));
+    }
+    return partitions;
+}
+
+template <typename IteratorTag>
+void test_loop_idx_n_prefetching(IteratorTag)
+{
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> c(10007, 1.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,10007,{c.data()},prefetch_distance_factor);
+
+    // the index passed to f is the position of the element, independently
+    // of the partition the element is in
+    std::vector<std::size_t> indices(c.size(), std::size_t(-1));
+    std::size_t base_idx = 0;
+    for (auto const& part: make_partitions(ctx.begin(), ctx.end(), 7))
+    {
+        std::size_t pos = part.first.index();
+        hpx::parallel::util::loop_idx_n(base_idx, part.first, part.second,
+            [&](std::size_t i, std::size_t idx) {
+                HPX_TEST_EQ(i, pos);
+                indices[pos++] = idx;
+            });
+        base_idx += part.second;
+    }
+    for (std::size_t i = 0; i != indices.size(); ++i)
+        HPX_TEST_EQ(indices[i], i);
+
+    // find the first element equal to 42 the way find_if does
+    std::size_t const found = 7919;
+    c[found] = 42.0;
+    c[found + 1000] = 42.0;
+
+    hpx::parallel::util::cancellation_token<std::size_t> tok(c.size());
+    base_idx = 0;
+    for (auto const& part: make_partitions(ctx.begin(), ctx.end(), 7))
+    {
+        hpx::parallel::util::loop_idx_n(base_idx, part.first, part.second,
+            tok,
+            [&](std::size_t i, std::size_t idx) {
+                if (c[i] == 42.0)
+                    tok.cancel(idx);
+            });
+        base_idx += part.second;
+    }
+    HPX_TEST_EQ(tok.get_data(), found);
+}
+
+template <typename IteratorTag>
+void test_loop_with_cleanup_prefetching(IteratorTag)
+{
+    typedef hpx::parallel::util::detail::prefetching_iterator<double> base_iterator;
+    typedef hpx::parallel::util::loop_n_iterator_mapping<base_iterator>::type
+        iterator;
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> c(10007, 1.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,10007,{c.data()},prefetch_distance_factor);
+
+    // the element throwing is in the middle of the third partition
+    auto partitions = make_partitions(ctx.begin(), ctx.end(), 4);
+    std::size_t const start = partitions[2].first.index();
+    std::size_t const throwing = start + 1001;
+
+    // the cleanup is called for the elements of the partition processed
+    // before the exception was thrown
+    std::vector<std::size_t> cleaned;
+    bool caught_exception = false;
+    try {
+        hpx::parallel::util::loop_with_cleanup_n(
+            partitions[2].first, partitions[2].second,
+            [&](iterator it) {
+                if (*it == throwing)
+                    throw std::runtime_error("test");
+                c[*it] = 42.0;
+            },
+            [&](iterator it) {
+                cleaned.push_back(*it);
+            });
+        HPX_TEST(false);
+    }
+    catch (std::runtime_error const&) {
+        caught_exception = true;
+    }
+    HPX_TEST(caught_exception);
+    HPX_TEST_EQ(cleaned.size(), throwing - start);
+    for (std::size_t i = 0; i != cleaned.size(); ++i)
+        HPX_TEST_EQ(cleaned[i], start + i);
+
+    // the same for the variant writing to a destination range
+    std::vector<double> dest(c.size(), 0.0);
+    std::size_t cleaned_dest = 0;
+    caught_exception = false;
+    try {
+        hpx::parallel::util::loop_with_cleanup_n(
+            partitions[2].first, partitions[2].second, dest.begin() + start,
+            [&](iterator it, std::vector<double>::iterator d) {
+                if (*it == throwing)
+                    throw std::runtime_error("test");
+                *d = c[*it];
+            },
+            [&](std::vector<double>::iterator d) {
+                HPX_TEST_EQ(*d, 42.0);
+                ++cleaned_dest;
+            });
+        HPX_TEST(false);
+    }
+    catch (std::runtime_error const&) {
+        caught_exception = true;
+    }
+    HPX_TEST(caught_exception);
+    HPX_TEST_EQ(cleaned_dest, throwing - start);
+
+    // loop_with_cleanup over whole ranges runs to completion
+    std::size_t calls = 0;
+    hpx::parallel::util::loop_with_cleanup(ctx.begin(), ctx.end(),
+        [&](iterator it) {
+            c[*it] = 43.0;
+            ++calls;
+        },
+        [&](iterator) {
+            HPX_TEST(false);
+        });
+    HPX_TEST_EQ(calls, c.size());
+}
+
+template <typename IteratorTag>
+void test_loop_cancellation_prefetching(IteratorTag)
+{
+    typedef hpx::parallel::util::detail::prefetching_iterator<double> base_iterator;
+    typedef hpx::parallel::util::loop_n_iterator_mapping<base_iterator>::type
+        iterator;
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> c(10007, 1.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,10007,{c.data()},prefetch_distance_factor);
+
+    auto partitions = make_partitions(ctx.begin(), ctx.end(), 4);
+    std::size_t const cancelling = partitions[1].first.index() + 1001;
+
+    // no element is processed after the token was cancelled, neither in
+    // the partition cancelling it nor in the following ones
+    std::vector<std::size_t> visits(c.size(), 0);
+    hpx::parallel::util::cancellation_token<> tok;
+    for (auto const& part: partitions)
+    {
+        hpx::parallel::util::loop_n(part.first, part.second, tok,
+            [&](iterator it) {
+                ++visits[*it];
+                if (*it == cancelling)
+                    tok.cancel();
+            });
+    }
+    HPX_TEST(tok.was_cancelled());
+    for (std::size_t i = 0; i != visits.size(); ++i)
+        HPX_TEST_EQ(visits[i], std::size_t(i <= cancelling ? 1 : 0));
+
+    // the same for loop
+    std::size_t calls = 0;
+    hpx::parallel::util::cancellation_token<> tok_loop;
+    hpx::parallel::util::loop(ctx.begin(), ctx.end(), tok_loop,
+        [&](iterator it) {
+            ++calls;
+            if (*it == cancelling)
+                tok_loop.cancel();
+        });
+    HPX_TEST_EQ(calls, cancelling + 1);
+
+    // an exception cancels the token, the cleanup is called for the
+    // elements processed before it
+    std::size_t cleaned = 0;
+    bool caught_exception = false;
+    hpx::parallel::util::cancellation_token<> tok_cleanup;
+    try {
+        hpx::parallel::util::loop_with_cleanup_n_with_token(
+            partitions[1].first, partitions[1].second, tok_cleanup,
+            [&](iterator it) {
+                if (*it == cancelling)
+                    throw std::runtime_error("test");
+            },
+            [&](iterator) {
+                ++cleaned;
+            });
+        HPX_TEST(false);
+    }
+    catch (std::runtime_error const&) {
+        caught_exception = true;
+    }
+    HPX_TEST(caught_exception);
+    HPX_TEST(tok_cleanup.was_cancelled());
+    HPX_TEST_EQ(cleaned, cancelling - partitions[1].first.index());
+}
+
+template <typename IteratorTag>
+void test_accumulate_n_prefetching(IteratorTag)
+{
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<double> c(10007);
+    std::iota(boost::begin(c), boost::end(c), 0.0);
+    auto ctx = hpx::parallel::util::detail::make_prefetcher_context<double>
+                (0,10007,{c.data()},prefetch_distance_factor);
+
+    // the partial sums of all partitions add up to the sum of all elements
+    double sum = 0.0;
+    for (auto const& part: make_partitions(ctx.begin(), ctx.end(), 7))
+    {
+        sum += hpx::parallel::util::accumulate_n(part.first, part.second,
+            0.0,
+            [&c](double acc, std::size_t i) {
+                return acc + c[i];
+            });
+    }
+    HPX_TEST_EQ(sum, 10006.0 * 10007.0 / 2.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_limited(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(10007, 1.0);
+    std::vector<float> f(10007, 1.0f);
+    std::vector<std::int32_t> idx(10007, 1);
+    std::vector<double> d(10007, 0.0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c, f, idx,
+        hpx::parallel::util::make_indirect_prefetch_container(idx, d));
+    ctx.prefetch_distance = 8;
+    ctx.limit_outstanding_lines(4);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            c[i] = 42.0 * f[i] + d[idx[i]];
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(c[i], 42.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_two_level(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    using hpx::parallel::util::make_two_level_prefetch_container;
+    using hpx::parallel::util::make_strided_prefetch_container;
+    using hpx::parallel::util::prefetch_hint;
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(10007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(10007, 1.0);
+    std::vector<double> xyz(3 * 10007, 1.0);
+
+    // c is prefetched far into L2 and near into L1, the x components of
+    // xyz far into L3
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor,
+        make_two_level_prefetch_container(c),
+        make_two_level_prefetch_container(
+            make_strided_prefetch_container(xyz, 3), prefetch_hint::t2));
+    ctx.prefetch_distance = 8;
+    ctx.near_distance = 1;
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            c[i] = 41.0 + xyz[3 * i];
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(c[i], 42.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_pages(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(100007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(100007, 0.0);
+    std::vector<double> xyz(3 * 100007, 1.0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c,
+        hpx::parallel::util::make_strided_prefetch_container(xyz, 3, 1));
+    ctx.prefetch_distance = 8;
+    ctx.enable_page_lookahead(4096);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            c[i] = 41.0 + xyz[3 * i + 1];
+        });
+
+    // the look-ahead crosses most of the pages of both containers, the
+    // pages ahead of the last ones are not touched
+    std::size_t const pages = (c.size() + 3 * c.size()) * sizeof(double) / 4096;
+    HPX_TEST(ctx.page_crossings() <= pages + 2);
+    HPX_TEST(ctx.page_crossings() + 64 >= pages);
+    HPX_TEST(ctx.page_warmings() <= ctx.page_crossings());
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(c[i], 42.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_bypass(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(100007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(100007, 0.0);
+    std::vector<double> xyz(3 * 100007, 1.0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c,
+        hpx::parallel::util::make_strided_prefetch_container(xyz, 3, 1));
+    ctx.enable_prefetch_bypass();
+
+    // the unit-stride container is left to the hardware prefetcher, the
+    // strided one is still prefetched
+    std::vector<bool> bypassed = ctx.bypassed_containers();
+    HPX_TEST_EQ(bypassed.size(), std::size_t(2));
+    HPX_TEST(bypassed[0]);
+    HPX_TEST(!bypassed[1]);
+
+    hpx::parallel::for_each(std::forward<ExPolicy>(policy),
+        ctx.begin(), ctx.end(),
+        [&](std::size_t i) {
+            c[i] = 41.0 + xyz[3 * i + 1];
+        });
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(c[i], 42.0);
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_throttle(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(100007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(100007, 0.0);
+    std::vector<double> b(100007, 1.0);
+
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c, b);
+    ctx.prefetch_distance = 8;
+    ctx.enable_bandwidth_throttle();
+
+    // the workers report to the throttle of their NUMA domain, run the
+    // loop until a window of the one of domain 0 was closed
+    hpx::parallel::util::bandwidth_throttle& throttle =
+        hpx::parallel::util::get_bandwidth_throttle(0);
+    std::size_t const windows_before = throttle.windows();
+    for (int run = 0;
+         run != 1000 && throttle.windows() == windows_before; ++run)
+    {
+        hpx::parallel::for_each(policy,
+            ctx.begin(), ctx.end(),
+            [&](std::size_t i) {
+                c[i] = 41.0 + b[i];
+            });
+    }
+
+    HPX_TEST(throttle.windows() != windows_before);
+    HPX_TEST(throttle.level() <=
+        hpx::parallel::util::bandwidth_throttle::max_level);
+    HPX_TEST(throttle.distance(8) >= 1 && throttle.distance(8) <= 8);
+    HPX_TEST_EQ(throttle.distance(0), std::size_t(0));
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+        HPX_TEST_EQ(c[i], 42.0);
+
+    // a series of windows of 1000 ticks each: the level is raised only
+    // while the demand rises and the bandwidth doesn't follow
+    hpx::parallel::util::bandwidth_throttle windows(1000);
+    std::uint64_t now = hpx::util::hardware::timestamp();
+    auto window = [&](std::size_t bytes, std::size_t in_flight)
+    {
+        now += 1000;
+        windows.report(bytes, in_flight, 1000, now);
+    };
+
+    // a steady loop is never throttled
+    for (int i = 0; i != 10; ++i)
+        window(10000, 4000);
+    HPX_TEST_EQ(windows.level(), 0u);
+    HPX_TEST_EQ(windows.saturated_windows(), std::size_t(0));
+
+    // the bandwidth follows the demand
+    window(20000, 8000);
+    HPX_TEST_EQ(windows.level(), 0u);
+
+    // the bandwidth levels off while the demand keeps rising
+    window(20000, 16000);
+    HPX_TEST_EQ(windows.level(), 1u);
+    window(20000, 32000);
+    HPX_TEST_EQ(windows.level(), 2u);
+    HPX_TEST_EQ(windows.distance(8), std::size_t(2));
+    window(20000, 32000);
+    HPX_TEST_EQ(windows.level(), 2u);
+
+    // the demand falls back
+    window(20000, 16000);
+    HPX_TEST_EQ(windows.level(), 1u);
+    window(20000, 8000);
+    HPX_TEST_EQ(windows.level(), 0u);
+    HPX_TEST_EQ(windows.saturated_windows(), std::size_t(2));
+    HPX_TEST_EQ(windows.windows(), std::size_t(16));
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_budget(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::size_t prefetch_distance_factor = 2;
+    std::vector<std::size_t> range(100007);
+    std::iota(boost::begin(range), boost::end(range), 0);
+
+    std::vector<double> c(100007, 0.0);
+    std::vector<double> d(100007, 0.0);
+
+    typedef hpx::parallel::util::prefetch_budget_share share_type;
+    std::size_t const unit = share_type::weight_unit;
+
+    hpx::parallel::util::prefetch_budget budget(64 * 1024);
+    share_type share_c(budget, unit);
+    share_type share_d(budget, 3 * unit);
+
+    auto ctx_c = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, c);
+    auto ctx_d = hpx::parallel::util::make_prefetcher_context(
+        range.begin(), range.end(), prefetch_distance_factor, d);
+    ctx_c.prefetch_distance = 8;
+    ctx_d.prefetch_distance = 8;
+    ctx_c.enable_prefetch_budget(share_c);
+    ctx_d.enable_prefetch_budget(share_d);
+
+    // a context running alone gets the whole budget
+    std::size_t const chunk_bytes = 1024;
+    HPX_TEST_EQ(share_c.max_distance(chunk_bytes), std::size_t(64));
+
+    // two active contexts share the budget in proportion to their weights
+    share_c.enter();
+    share_d.enter();
+    HPX_TEST_EQ(budget.active(), std::size_t(2));
+    HPX_TEST_EQ(share_c.max_distance(chunk_bytes), std::size_t(16));
+    HPX_TEST_EQ(share_d.max_distance(chunk_bytes), std::size_t(48));
+
+    // the share of a context is split between its workers
+    share_c.enter();
+    HPX_TEST_EQ(share_c.max_distance(chunk_bytes), std::size_t(8));
+    HPX_TEST_EQ(share_d.max_distance(chunk_bytes), std::size_t(48));
+    share_c.leave(0, 0);
+    share_c.leave(0, 0);
+    HPX_TEST_EQ(share_d.max_distance(chunk_bytes), std::size_t(64));
+
+    // the share of d shrinks while the workers of c are active
+    std::atomic<std::size_t> shrunk(0), active(0);
+    hpx::parallel::for_each(policy, ctx_c.begin(), ctx_c.end(),
+        [&](std::size_t i) {
+            c[i] = 42.0;
+            if (share_d.max_distance(chunk_bytes) < 64)
+                ++shrunk;
+            if (share_c.active() && budget.active() == 2)
+                ++active;
+        });
+    HPX_TEST_EQ(shrunk.load(), range.size());
+    HPX_TEST_EQ(active.load(), range.size());
+    HPX_TEST(!share_c.active());
+    share_d.leave(0, 0);
+
+    // the weights are updated by the workers of the loops
+    hpx::parallel::for_each(policy, ctx_d.begin(), ctx_d.end(),
+        [&](std::size_t i) {
+            d[i] = 42.0;
+        });
+    HPX_TEST(share_c.weight() != 0);
+    HPX_TEST(share_d.weight() != 0);
+
+    HPX_TEST_EQ(budget.active(), std::size_t(0));
+
+    // verify values
+    for (std::size_t i = 0; i != range.size(); ++i)
+    {
+        HPX_TEST_EQ(c[i], 42.0);
+        HPX_TEST_EQ(d[i], 42.0);
+    }
+}
+
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_prefetching_jump_pointers(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    std::list<double> c(10007, 1.0);
+    auto table = hpx::parallel::util::make_jump_pointer_table(c, 8);
+
+    hpx::parallel::for_each(policy, table.begin(), table.end(),
+        [](double& d) {
+            d = 42.0;
+        });
+
+    // the table is rebuilt after the list was changed through the hook
+    auto hook = table.invalidation_hook();
+    c.push_front(1.0);
+    c.push_back(1.0);
+    hook();
+    HPX_TEST(!table.valid());
+
+    hpx::parallel::for_each(policy, table.begin(), table.end(),
+        [](double& d) {
+            d += 1.0;
+        });
+
+    // verify values
+    HPX_TEST_EQ(c.front(), 2.0);
+    HPX_TEST_EQ(c.back(), 2.0);
+    c.pop_front();
+    c.pop_back();
+    for (double d: c)
+        HPX_TEST_EQ(d, 43.0);
+
+    // end() doesn't rebuild the table, the iterators created before the
+    // list was changed stay usable
+    auto first = table.begin();
+    c.push_back(43.0);
+    hook();
+    auto last = table.end();
+    HPX_TEST(!table.valid());
+
+    std::size_t count = 0;
+    for (auto it = first; it != last; ++it)
+    {
+        HPX_TEST_EQ(*it, 43.0);
+        ++count;
+    }
+    HPX_TEST_EQ(count, c.size());
+}
+
+#if defined(HPX_HAVE_CXX20_COROUTINES)
+template <typename ExPolicy, typename IteratorTag>
+void test_for_each_interleaved(ExPolicy && policy, IteratorTag)
+{
+    static_assert(
+        hpx::parallel::is_execution_policy<ExPolicy>::value,
+        "hpx::parallel::is_execution_policy<ExPolicy>::value");
+
+    struct node
+    {
+        node* next;
+        std::size_t value;
+    };
+
+    // chains of dependent loads through randomly linked nodes, every
+    // tenth node ends a chain
+    std::vector<node> nodes(10007);
+    std::mt19937 gen(42);
+    for (std::size_t i = 0; i != nodes.size(); ++i)
+    {
+        nodes[i].value = i;
+        nodes[i].next = (i % 10 == 9 || i + 1 == nodes.size()) ? nullptr :
+            &nodes[i + 1 + gen() % (nodes.size() - i - 1)];
+    }
+
+    std::vector<std::size_t> heads(1000);
+    std::iota(boost::begin(heads), boost::end(heads), 0);
+
+    std::vector<std::size_t> sums(heads.size(), 0);
+    hpx::parallel::for_each_interleaved(std::forward<ExPolicy>(policy),
+        heads.begin(), heads.end(), 8,
+        [&](std::size_t head) -> hpx::parallel::util::prefetch_task
+        {
+            std::size_t sum = 0;
+            for (node* n = &nodes[head]; n != nullptr; n = n->next)
+            {
+                sum += n->value;
+                if (n->next != nullptr)
+                    co_await hpx::parallel::util::prefetch_and_switch(n->next);
+            }
+            sums[head] = sum;
+        });
+
+    // verify values
+    for (std::size_t head: heads)
+    {
+        std::size_t sum = 0;
+        for (node* n = &nodes[head]; n != nullptr; n = n->next)
+            sum += n->value;
+        HPX_TEST_EQ(sums[head], sum);
+    }
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 template <typename ExPolicy, typename IteratorTag>
 void test_for_each_prefetching_exception(ExPolicy policy, IteratorTag)
@@ -0,0 +1,179 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_JUMP_POINTER_TABLE_HPP)
+#define HPX_PARALLEL_UTIL_JUMP_POINTER_TABLE_HPP
+
+#include <hpx/config.hpp>
+#include <hpx/parallel/util/loop.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace hpx { namespace parallel { namespace util
+{
+    template <typename Container>
+    class jump_pointer_table;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // A forward iterator over a node based container (std::list, std::map,
+    // intrusive lists, ...) which prefetches the node 'distance' nodes ahead
+    // whenever it is incremented. The addresses of the nodes are looked up
+    // in the jump pointer table the iterator was created from.
+    template <typename Iter>
+    class jump_prefetching_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename std::iterator_traits<Iter>::value_type value_type;
+        typedef typename std::iterator_traits<Iter>::difference_type
+            difference_type;
+        typedef typename std::iterator_traits<Iter>::pointer pointer;
+        typedef typename std::iterator_traits<Iter>::reference reference;
+
+        jump_prefetching_iterator()
+          : it_(), pos_(0), jumps_(nullptr), size_(0), distance_(0),
+            hint_(prefetch_hint::t0)
+        {}
+
+        jump_prefetching_iterator(Iter it, std::size_t pos,
+                void const* const* jumps, std::size_t size,
+                std::size_t distance, prefetch_hint hint)
+          : it_(it), pos_(pos), jumps_(jumps), size_(size),
+            distance_(distance), hint_(hint)
+        {}
+
+        Iter base() const { return it_; }
+
+        reference operator*() const { return *it_; }
+        pointer operator->() const { return std::addressof(*it_); }
+
+        jump_prefetching_iterator& operator++()
+        {
+            ++it_;
+            ++pos_;
+            if (pos_ + distance_ < size_)
+                detail::prefetch_address(jumps_[pos_ + distance_], hint_);
+            return *this;
+        }
+
+        jump_prefetching_iterator operator++(int)
+        {
+            jump_prefetching_iterator tmp(*this);
+            operator++();
+            return tmp;
+        }
+
+        bool operator==(jump_prefetching_iterator const& rhs) const
+        {
+            return it_ == rhs.it_;
+        }
+        bool operator!=(jump_prefetching_iterator const& rhs) const
+        {
+            return it_ != rhs.it_;
+        }
+
+    private:
+        Iter it_;
+        std::size_t pos_;
+        void const* const* jumps_;
+        std::size_t size_;
+        std::size_t distance_;
+        prefetch_hint hint_;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // The side table of the jump pointers of a node based container: the
+    // address of the element held by each node, in traversal order, such
+    // that an iterator at node i finds the node i + distance without
+    // chasing the links in between. The table is built by begin() and
+    // rebuilt lazily by the next call to begin() after it was invalidated.
+    // end() never touches the table, so iterators created earlier stay
+    // usable (their prefetches may be stale, but never invalid accesses).
+    //
+    // The table has to be invalidated whenever the structure of the
+    // container changes (insertion, removal, reordering of nodes), either
+    // by calling invalidate() or by the hook returned by
+    // invalidation_hook(). Creating iterators is not thread-safe, all
+    // iterators should be created before a parallel loop starts.
+    template <typename Container>
+    class jump_pointer_table
+    {
+    public:
+        typedef decltype(std::begin(std::declval<Container&>())) base_iterator;
+        typedef jump_prefetching_iterator<base_iterator> iterator;
+
+        explicit jump_pointer_table(Container& c, std::size_t distance = 8,
+                prefetch_hint hint = prefetch_hint::t0)
+          : c_(c), distance_(distance == 0 ? 1 : distance), hint_(hint),
+            valid_(false)
+        {}
+
+        void invalidate() { valid_ = false; }
+        bool valid() const { return valid_; }
+
+        // a callable invalidating the table, to be invoked by the code
+        // mutating the container
+        auto invalidation_hook()
+        {
+            return [this]() { invalidate(); };
+        }
+
+        std::size_t distance() const { return distance_; }
+
+        iterator begin()
+        {
+            rebuild();
+
+            // the nodes [1, distance] are not covered by the increments
+            std::size_t const size = jumps_.size();
+            for (std::size_t i = 1; i <= distance_ && i < size; ++i)
+                detail::prefetch_address(jumps_[i], hint_);
+
+            return iterator(std::begin(c_), 0, jumps_.data(), size,
+                distance_, hint_);
+        }
+
+        // the end iterator is only compared against, it doesn't refer to
+        // the table
+        iterator end()
+        {
+            return iterator(std::end(c_), 0, nullptr, 0, distance_, hint_);
+        }
+
+    private:
+        void rebuild()
+        {
+            if (valid_)
+                return;
+
+            jumps_.clear();
+            for (auto&& x: c_)
+                jumps_.push_back(std::addressof(x));
+            valid_ = true;
+        }
+
+        Container& c_;
+        std::size_t distance_;
+        prefetch_hint hint_;
+        bool valid_;
+        std::vector<void const*> jumps_;
+    };
+
+    // Create the jump pointer table for a node based container, iterate
+    // over [table.begin(), table.end()) to prefetch 'distance' nodes ahead.
+    template <typename Container>
+    jump_pointer_table<Container>
+    make_jump_pointer_table(Container& c, std::size_t distance = 8,
+        prefetch_hint hint = prefetch_hint::t0)
+    {
+        return jump_pointer_table<Container>(c, distance, hint);
+    }
+}}}
+
+#endif
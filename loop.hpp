@@ -7,17 +7,59 @@
 #define HPX_PARALLEL_UTIL_LOOP_MAY_27_2014_1040PM
 
 #include <hpx/hpx_fwd.hpp>
+#include <hpx/parallel/util/bandwidth_throttle.hpp>
+#include <hpx/parallel/util/cache_topology.hpp>
 #include <hpx/parallel/util/cancellation_token.hpp>
+#include <hpx/parallel/util/prefetch_budget.hpp>
+#include <hpx/parallel/util/prefetch_calibration.hpp>
+#include <hpx/parallel/util/prefetch_coroutine.hpp>
+#include <hpx/parallel/util/prefetch_helper.hpp>
+#include <hpx/parallel/util/prefetch_schedule.hpp>
+#include <hpx/util/hardware/timestamp.hpp>
 
 #include <iterator>
 #include <algorithm>
-#include <boost/range/irange.hpp>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/iterator/counting_iterator.hpp>
+
+#include <xmmintrin.h>
 
 namespace hpx { namespace parallel { namespace util
 {
     ///////////////////////////////////////////////////////////////////////////
     namespace detail
     {
+        ///////////////////////////////////////////////////////////////////////
+        template <typename Itr, typename Containers>
+        class basic_prefetching_iterator;
+
+        // The loop helpers below are dispatched on the category of the
+        // iterator they are given. Prefetching iterators get their own
+        // dispatch tag, which selects implementations running the chunked
+        // prefetching schedule over the elements of the base range.
+        struct prefetching_iterator_tag {};
+
+        template <typename Iter>
+        struct loop_iterator_category
+        {
+            typedef typename std::iterator_traits<Iter>::iterator_category
+                type;
+        };
+
+        template <typename Itr, typename Containers>
+        struct loop_iterator_category<
+            basic_prefetching_iterator<Itr, Containers> >
+        {
+            typedef prefetching_iterator_tag type;
+        };
+
         ///////////////////////////////////////////////////////////////////////
         // Helper class to repeatedly call a function starting from a given
         // iterator position.
@@ -54,7 +96,7 @@ namespace hpx { namespace parallel { namespace util
     HPX_FORCEINLINE Begin
     loop(Begin begin, End end, F && f)
     {
-        typedef typename std::iterator_traits<Begin>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Begin>::type cat;
         return detail::loop<cat>::call(begin, end, std::forward<F>(f));
     }
 
@@ -62,257 +104,2358 @@ namespace hpx { namespace parallel { namespace util
     HPX_FORCEINLINE Begin
     loop(Begin begin, End end, CancelToken& tok, F && f)
     {
-        typedef typename std::iterator_traits<Begin>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Begin>::type cat;
         return detail::loop<cat>::call(begin, end, tok, std::forward<F>(f));
     };
 
     ///////////////////////////////////////////////////////////////////////////
+    // The way the data of a prefetched container is brought into the cache.
+    enum class prefetch_hint
+    {
+        t0,         // prefetch into all cache levels
+        t1,         // prefetch into L2 and below
+        t2,         // prefetch into L3 and below
+        nta,        // non-temporal, minimize cache pollution for read-once data
+        write,      // prefetch with intent to write (prefetchw)
+        touch,      // issue a demand load, the element has to be valid
+        none        // do not prefetch this container at all
+    };
+
     namespace detail
     {
+        ///////////////////////////////////////////////////////////////////////
+        HPX_FORCEINLINE void
+        prefetch_address(void const* p, prefetch_hint hint)
+        {
+            char const* addr = static_cast<char const*>(p);
+            switch (hint)
+            {
+            case prefetch_hint::t0:
+                _mm_prefetch(addr, _MM_HINT_T0);
+                break;
+
+            case prefetch_hint::t1:
+                _mm_prefetch(addr, _MM_HINT_T1);
+                break;
+
+            case prefetch_hint::t2:
+                _mm_prefetch(addr, _MM_HINT_T2);
+                break;
+
+            case prefetch_hint::nta:
+                _mm_prefetch(addr, _MM_HINT_NTA);
+                break;
+
+            case prefetch_hint::write:
+#if defined(__GNUC__)
+                __builtin_prefetch(addr, 1, 3);
+#else
+                _mm_prefetch(addr, _MM_HINT_T0);
+#endif
+                break;
 
-        //New random access iterator which is used for prefetching containers within lambda functions
-        template<typename T>
-        class prefetching_iterator: public std::iterator<std::random_access_iterator_tag, std::size_t>
+            case prefetch_hint::touch:
+                (void)*static_cast<char const volatile*>(addr);
+                break;
+
+            case prefetch_hint::none:
+                break;
+            }
+        }
+
+        // The default issue policy of the containers: the prefetches are
+        // issued right away. Issue policies are called with the address to
+        // prefetch, the element of the base range for which it is needed,
+        // and the hint to use.
+        struct issue_prefetch
+        {
+            HPX_FORCEINLINE void operator()(void const* p,
+                std::size_t /*element*/, prefetch_hint hint) const
+            {
+                prefetch_address(p, hint);
+            }
+        };
+
+        ///////////////////////////////////////////////////////////////////////
+        // the number of line fill buffers of a typical core
+        std::size_t const default_outstanding_lines = 10;
+
+        // The queue of the prefetches of one worker whose issue is limited
+        // (see prefetcher_context::limit_outstanding_lines). The lines added
+        // during one step (a line block of a chunk) are ordered by the
+        // element which needs them, so that the streams consumed first are
+        // issued first. Lines exceeding the capacity of the queue are
+        // dropped.
+        class prefetch_issue_queue
         {
-            public:
+            static std::size_t const capacity = 64;
 
-            using base_iterator = std::vector<std::size_t>::iterator;
+            struct entry
+            {
+                void const* address;
+                std::size_t element;
+                prefetch_hint hint;
+            };
 
-            std::vector< T * > M_;
-            base_iterator base;
-            std::size_t chunk_size;
-            std::size_t range_size;
-            std::size_t idx;
+        public:
+            prefetch_issue_queue()
+              : head_(0), size_(0), step_begin_(0), dropped_(0)
+            {}
+
+            void push(void const* p, std::size_t element, prefetch_hint hint)
+            {
+                if (size_ == capacity)
+                {
+                    ++dropped_;
+                    return;
+                }
+
+                std::size_t pos = head_ + size_;
+                ++size_;
+                for (/**/; pos != step_begin_ && at(pos - 1).element > element;
+                     --pos)
+                {
+                    at(pos) = at(pos - 1);
+                }
+                at(pos) = entry{ p, element, hint };
+            }
+
+            // issue up to max_lines of the queued lines, oldest first, and
+            // start the next step
+            void issue(std::size_t max_lines)
+            {
+                for (/**/; max_lines != 0 && size_ != 0; --max_lines)
+                {
+                    entry const& e = at(head_);
+                    prefetch_address(e.address, e.hint);
+                    ++head_;
+                    --size_;
+                }
+                step_begin_ = head_ + size_;
+            }
+
+            void clear()
+            {
+                head_ += size_;
+                size_ = 0;
+                step_begin_ = head_;
+            }
+
+            std::size_t size() const { return size_; }
+
+            // the number of lines which were dropped as the queue was full
+            std::size_t dropped() const { return dropped_; }
+
+            // the queue of the calling worker thread
+            static prefetch_issue_queue& local()
+            {
+                static thread_local prefetch_issue_queue queue;
+                return queue;
+            }
+
+        private:
+            entry& at(std::size_t i) { return entries_[i % capacity]; }
+
+            entry entries_[capacity];
+            std::size_t head_;
+            std::size_t size_;
+            std::size_t step_begin_;
+            std::size_t dropped_;
+        };
+
+        ///////////////////////////////////////////////////////////////////////
+        // The number of page boundaries crossed by the look-ahead of the
+        // prefetches of a container, and the number of loads issued to
+        // translate the pages ahead of them.
+        struct page_counters
+        {
+            std::size_t crossings;
+            std::size_t warmings;
+        };
+
+        // Describes one of the containers which are prefetched while the
+        // loop is running. Every container gets its own cache-line stride,
+        // so containers of different element types are prefetched at their
+        // own granularity, and its own prefetch hint.
+        //
+        // Processing element i of the base range is expected to access the
+        // elements [stride*i + offset, stride*i + offset + width) of the
+        // container, which allows to describe fields of arrays of structs
+        // and interleaved (e.g. xyz) layouts. A line size of zero selects
+        // the prefetch granularity of the machine.
+        template <typename T>
+        struct prefetch_container
+        {
+            typedef T value_type;
+
+            prefetch_container(T* data,
+                    prefetch_hint hint = prefetch_hint::t0,
+                    std::size_t stride = 1, std::size_t offset = 0,
+                    std::size_t width = 1, std::size_t line_size = 0)
+              : data_(data), stride_(stride == 0 ? 1 : stride),
+                offset_(offset), width_(width == 0 ? 1 : width),
+                line_size_(line_size == 0 ?
+                    get_cache_topology().prefetch_granularity : line_size),
+                line_elems_(sizeof(T) < line_size_ ?
+                    line_size_ / sizeof(T) : 1),
+                line_stride_(stride_ < line_elems_ ? line_elems_ / stride_ : 1),
+                hint_(hint), near_hint_(prefetch_hint::none), bypass_(false)
+            {}
+
+            // issue the prefetches for all cache lines accessed while
+            // processing the elements [first, last) of the base range
+            template <typename Issue = issue_prefetch>
+            HPX_FORCEINLINE void
+            prefetch(std::size_t first, std::size_t last,
+                Issue && issue = Issue()) const
+            {
+                prefetch(first, last, hint_, issue);
+            }
+
+            template <typename Issue>
+            HPX_FORCEINLINE void
+            prefetch(std::size_t first, std::size_t last, prefetch_hint hint,
+                Issue && issue) const
+            {
+                if (hint == prefetch_hint::none || first >= last)
+                    return;
+
+                if (stride_ < line_elems_)
+                {
+                    // consecutive iterations share cache lines, issue one
+                    // prefetch for each line starting in the accessed range
+                    std::size_t e = stride_ * first + offset_;
+                    std::size_t const e_last = stride_ * last + offset_;
+
+                    e = ((e + line_elems_ - 1) / line_elems_) * line_elems_;
+                    for (/**/; e < e_last; e += line_elems_)
+                        issue(data_ + e, (e - offset_) / stride_, hint);
+                }
+                else
+                {
+                    // each iteration touches cache lines of its own
+                    for (/**/; first != last; ++first)
+                    {
+                        T const* p = data_ + stride_ * first + offset_;
+                        std::uintptr_t addr =
+                            reinterpret_cast<std::uintptr_t>(p) &
+                                ~std::uintptr_t(line_size_ - 1);
+                        std::uintptr_t const end =
+                            reinterpret_cast<std::uintptr_t>(p + width_);
+
+                        for (/**/; addr < end; addr += line_size_)
+                        {
+                            issue(reinterpret_cast<void const*>(addr), first,
+                                hint);
+                        }
+                    }
+                }
+            }
+
+            // prefetch the elements which are 'ahead' positions in front of
+            // [first, last)
+            template <typename Issue = issue_prefetch>
+            HPX_FORCEINLINE void
+            prefetch_ahead(std::size_t first, std::size_t last,
+                std::size_t ahead, std::size_t range_size,
+                Issue && issue = Issue()) const
+            {
+                if (bypass_)
+                    return;
+
+                last += ahead;
+                if (range_size < last)
+                    last = range_size;
+                prefetch(first + ahead, last, issue);
+            }
+
+            // prefetch the elements which are 'near' positions in front of
+            // [first, last) using the near hint (the second level of a two
+            // level schedule), nothing if the container has no near hint
+            template <typename Issue = issue_prefetch>
+            HPX_FORCEINLINE void
+            prefetch_near(std::size_t first, std::size_t last,
+                std::size_t near, std::size_t range_size,
+                Issue && issue = Issue()) const
+            {
+                if (near_hint_ == prefetch_hint::none || bypass_)
+                    return;
+
+                last += near;
+                if (range_size < last)
+                    last = range_size;
+                prefetch(first + near, last, near_hint_, issue);
+            }
+
+            // Contiguous accesses (without gaps between the elements
+            // accessed by consecutive iterations) form streams which are
+            // covered by the hardware prefetcher, strided accesses skipping
+            // parts of the lines are not.
+            bool regular_stream() const
+            {
+                return width_ >= stride_;
+            }
+
+            // leave the prefetches of a regular stream to the hardware
+            void bypass_regular_stream(bool enable)
+            {
+                bypass_ = enable && regular_stream();
+            }
+
+            bool bypassed() const
+            {
+                return bypass_;
+            }
+
+            // Issue a load one page ahead of each page boundary crossed by
+            // the look-ahead [first + ahead, last + ahead), so that the page
+            // is translated by the time the prefetches reach it (prefetches
+            // missing the TLB are dropped by many cores). Only pages holding
+            // elements accessed by the loop are touched.
+            HPX_FORCEINLINE void
+            warm_pages_ahead(std::size_t first, std::size_t last,
+                std::size_t ahead, std::size_t range_size,
+                std::size_t page_size, page_counters& c) const
+            {
+                if (hint_ == prefetch_hint::none)
+                    return;
+
+                first += ahead;
+                last += ahead;
+                if (range_size < last)
+                    last = range_size;
+                if (first >= last)
+                    return;
+
+                // the boundaries between the first element accessed for
+                // (first - 1) and the one accessed for (last - 1), which
+                // makes consecutive look-aheads count every boundary once
+                std::uintptr_t const begin = reinterpret_cast<std::uintptr_t>(
+                    data_ + stride_ * first + offset_) - stride_ * sizeof(T);
+                std::uintptr_t const end = reinterpret_cast<std::uintptr_t>(
+                    data_ + stride_ * (last - 1) + offset_);
+                std::uintptr_t const extent = reinterpret_cast<std::uintptr_t>(
+                    data_ + stride_ * (range_size - 1) + offset_ + width_);
+
+                for (std::uintptr_t b = (begin / page_size + 1) * page_size;
+                     b <= end; b += page_size)
+                {
+                    ++c.crossings;
+                    if (b + page_size < extent)
+                    {
+                        prefetch_address(
+                            reinterpret_cast<void const*>(b + page_size),
+                            prefetch_hint::touch);
+                        ++c.warmings;
+                    }
+                }
+            }
+
+            // prefetch the elements following the first chunk at 'first'
+            // which are not covered by prefetch_ahead
+            HPX_FORCEINLINE void
+            prefetch_prologue(std::size_t first, std::size_t chunk_size,
+                std::size_t ahead, std::size_t range_size) const
+            {
+                if (bypass_)
+                    return;
+
+                std::size_t last = first + ahead;
+                if (range_size < last)
+                    last = range_size;
+                prefetch(first + chunk_size, last);
+            }
+
+            // The position of the first element of the base range inside of
+            // its cache line (in iterations): element i is the first one
+            // accessed in a cache line if (i + line_offset()) is a multiple
+            // of line_stride_. Zero if the accesses can't be aligned to the
+            // cache lines at all.
+            std::size_t line_offset() const
+            {
+                std::size_t const bytes = stride_ * sizeof(T);
+                if (stride_ >= line_elems_ || line_size_ % bytes != 0)
+                    return 0;
+
+                std::size_t const misalignment =
+                    reinterpret_cast<std::uintptr_t>(data_ + offset_) %
+                        line_size_;
+                if (misalignment % bytes != 0)
+                    return 0;
+                return misalignment / bytes;
+            }
+
+            // the number of bytes prefetched for n consecutive elements of
+            // the base range
+            std::size_t footprint(std::size_t n) const
+            {
+                if (hint_ == prefetch_hint::none)
+                    return 0;
+
+                if (stride_ < line_elems_)
+                {
+                    return ((n * stride_ * sizeof(T) + line_size_ - 1) /
+                        line_size_) * line_size_;
+                }
+                return n * ((width_ * sizeof(T) + line_size_ - 1) /
+                    line_size_) * line_size_;
+            }
+
+            T* data_;
+            std::size_t stride_;
+            std::size_t offset_;
+            std::size_t width_;
+            std::size_t line_size_;
+            std::size_t line_elems_;
+            // number of iterations of the base range per cache line
+            std::size_t line_stride_;
+            prefetch_hint hint_;
+            // the hint used for the near level of a two level schedule
+            prefetch_hint near_hint_;
+            // whether the prefetches are left to the hardware prefetcher
+            bool bypass_;
+        };
+
+        ///////////////////////////////////////////////////////////////////////
+        // Describes a container which is accessed indirectly through an
+        // index array, i.e. as data[index[i]] while processing element i.
+        // The index array is prefetched twice the distance ahead, the
+        // gathered elements are prefetched once the distance ahead (at which
+        // point their index is expected to be in the cache already).
+        template <typename T, typename Index>
+        struct indirect_prefetch_container
+        {
+            typedef T value_type;
+
+            indirect_prefetch_container(Index const* index, T* data,
+                    prefetch_hint hint = prefetch_hint::t0,
+                    bool prefetch_index = true, std::size_t line_size = 0)
+              : index_(index, prefetch_index ?
+                    prefetch_hint::t0 : prefetch_hint::none, 1, 0, 1,
+                    line_size),
+                data_(data), hint_(hint), near_hint_(prefetch_hint::none)
+            {}
+
+            // issue one prefetch for each of the gathered elements
+            // data[index[i]], i in [first, last)
+            template <typename Issue = issue_prefetch>
+            HPX_FORCEINLINE void
+            prefetch(std::size_t first, std::size_t last,
+                Issue && issue = Issue()) const
+            {
+                if (hint_ == prefetch_hint::none)
+                    return;
+
+                for (/**/; first < last; ++first)
+                    issue(data_ + index_.data_[first], first, hint_);
+            }
+
+            template <typename Issue = issue_prefetch>
+            HPX_FORCEINLINE void
+            prefetch_ahead(std::size_t first, std::size_t last,
+                std::size_t ahead, std::size_t range_size,
+                Issue && issue = Issue()) const
+            {
+                index_.prefetch_ahead(first, last, 2 * ahead, range_size,
+                    issue);
+
+                last += ahead;
+                if (range_size < last)
+                    last = range_size;
+                prefetch(first + ahead, last, issue);
+            }
+
+            // the near level of a two level schedule moves the gathered
+            // elements closer to the core
+            template <typename Issue = issue_prefetch>
+            HPX_FORCEINLINE void
+            prefetch_near(std::size_t first, std::size_t last,
+                std::size_t near, std::size_t range_size,
+                Issue && issue = Issue()) const
+            {
+                if (near_hint_ == prefetch_hint::none)
+                    return;
+
+                last += near;
+                if (range_size < last)
+                    last = range_size;
+
+                for (first += near; first < last; ++first)
+                    issue(data_ + index_.data_[first], first, near_hint_);
+            }
+
+            // the index array is a regular stream, the gathered elements
+            // are always prefetched
+            void bypass_regular_stream(bool enable)
+            {
+                index_.bypass_regular_stream(enable);
+            }
+
+            bool bypassed() const
+            {
+                return index_.bypassed();
+            }
+
+            // the pages of the gathered elements are unknown in advance,
+            // only the index array is looked ahead
+            HPX_FORCEINLINE void
+            warm_pages_ahead(std::size_t first, std::size_t last,
+                std::size_t ahead, std::size_t range_size,
+                std::size_t page_size, page_counters& c) const
+            {
+                index_.warm_pages_ahead(first, last, 2 * ahead, range_size,
+                    page_size, c);
+            }
+
+            HPX_FORCEINLINE void
+            prefetch_prologue(std::size_t first, std::size_t chunk_size,
+                std::size_t ahead, std::size_t range_size) const
+            {
+                // the index entries up to twice the distance ahead are not
+                // covered otherwise
+                std::size_t last = first + 2 * ahead;
+                if (range_size < last)
+                    last = range_size;
+                if (!index_.bypassed())
+                    index_.prefetch(first, last);
+
+                last = first + ahead;
+                if (range_size < last)
+                    last = range_size;
+                prefetch(first + chunk_size, last);
+            }
+
+            // the iteration is aligned to the cache lines of the index array
+            std::size_t line_offset() const
+            {
+                return index_.line_offset();
+            }
+
+            // every gathered element is assumed to be in a cache line of
+            // its own
+            std::size_t footprint(std::size_t n) const
+            {
+                std::size_t bytes = index_.footprint(n);
+                if (hint_ != prefetch_hint::none)
+                    bytes += n * index_.line_size_;
+                return bytes;
+            }
+
+            prefetch_container<Index const> index_;
+            T* data_;
+            prefetch_hint hint_;
+            prefetch_hint near_hint_;
+            // the iteration is driven by the index array
+            std::size_t line_stride_ = index_.line_stride_;
+        };
+
+        ///////////////////////////////////////////////////////////////////////
+        // Call f for each of the prefetched containers, the containers are
+        // either held in a std::vector (all of the same type) or in a
+        // std::tuple (any mix of types).
+        template <typename T, typename F>
+        HPX_FORCEINLINE void
+        for_each_container(std::vector<prefetch_container<T> > const& c,
+            F && f)
+        {
+            for (auto const& x: c)
+                f(x);
+        }
+
+        template <typename T, typename F>
+        HPX_FORCEINLINE void
+        for_each_container(std::vector<prefetch_container<T> >& c, F && f)
+        {
+            for (auto& x: c)
+                f(x);
+        }
+
+        template <typename Tuple, typename F, std::size_t ... Is>
+        HPX_FORCEINLINE void
+        for_each_container(Tuple & t, F && f, std::index_sequence<Is...>)
+        {
+            int const sequencer[] = {
+                0, (f(std::get<Is>(t)), 0)...
+            };
+            (void)sequencer;
+        }
+
+        template <typename ... Ts, typename F>
+        HPX_FORCEINLINE void
+        for_each_container(std::tuple<Ts...> const& t, F && f)
+        {
+            for_each_container(t, std::forward<F>(f),
+                std::index_sequence_for<Ts...>());
+        }
+
+        template <typename ... Ts, typename F>
+        HPX_FORCEINLINE void
+        for_each_container(std::tuple<Ts...>& t, F && f)
+        {
+            for_each_container(t, std::forward<F>(f),
+                std::index_sequence_for<Ts...>());
+        }
+
+        // The smallest cache-line stride of all containers, i.e. the number
+        // of iterations after which the container with the largest
+        // footprint per iteration moves on to the next cache line.
+        template <typename Containers>
+        std::size_t min_line_stride(Containers const& c)
+        {
+            std::size_t stride = std::size_t(-1);
+            for_each_container(c,
+                [&stride](auto const& x)
+                {
+                    if (x.line_stride_ < stride)
+                        stride = x.line_stride_;
+                });
+            return stride == std::size_t(-1) ? 1 : stride;
+        }
+
+        // The cache-line stride and the line offset of the first (primary)
+        // container, the chunks are aligned to its cache lines.
+        template <typename Containers>
+        std::pair<std::size_t, std::size_t>
+        primary_line_alignment(Containers const& c)
+        {
+            std::pair<std::size_t, std::size_t> result(1, 0);
+            bool primary = true;
+            for_each_container(c,
+                [&result, &primary](auto const& x)
+                {
+                    if (primary)
+                    {
+                        result.first = x.line_stride_;
+                        result.second = x.line_offset();
+                        primary = false;
+                    }
+                });
+            return result;
+        }
+
+        // The number of bytes of all containers which are prefetched for n
+        // consecutive elements of the base range.
+        template <typename Containers>
+        std::size_t footprint(Containers const& c, std::size_t n)
+        {
+            std::size_t bytes = 0;
+            for_each_container(c,
+                [&bytes, n](auto const& x)
+                {
+                    bytes += x.footprint(n);
+                });
+            return bytes;
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Hill-climbing search for the prefetch distance, run by each worker
+        // while it processes its chunks. The cost per element is measured
+        // over epochs of a few chunks using the timestamp counter. After each
+        // epoch the distance is moved by one chunk, the direction of the
+        // search is reversed whenever the cost got worse.
+        class prefetch_distance_tuner
+        {
+        public:
+            static std::size_t const epoch_chunks = 8;
+
+            prefetch_distance_tuner(std::size_t distance,
+                    std::size_t max_distance)
+              : distance_(distance), max_distance_(max_distance),
+                increasing_(true), chunks_(0), elements_(0), last_cost_(0),
+                start_(hpx::util::hardware::timestamp())
+            {
+                if (distance_ == 0)
+                    distance_ = 1;
+                if (distance_ > max_distance_)
+                    distance_ = max_distance_;
+            }
+
+            std::size_t distance() const { return distance_; }
+
+            // account for a finished chunk of the given number of elements,
+            // returns true if the distance was increased, in which case the
+            // chunk skipped by the new distance has not been prefetched
+            HPX_FORCEINLINE bool chunk_done(std::size_t elements)
+            {
+                elements_ += elements;
+                if (++chunks_ != epoch_chunks)
+                    return false;
+                return next_epoch();
+            }
+
+        private:
+            bool next_epoch()
+            {
+                std::uint64_t const now = hpx::util::hardware::timestamp();
+                double const cost = double(now - start_) / double(elements_);
+
+                if (last_cost_ != 0 && cost > last_cost_)
+                    increasing_ = !increasing_;
+                if (increasing_ && distance_ == max_distance_)
+                    increasing_ = false;
+                else if (!increasing_ && distance_ == 1)
+                    increasing_ = true;
+
+                if (increasing_)
+                    ++distance_;
+                else if (distance_ != 1)
+                    --distance_;
+
+                last_cost_ = cost;
+                chunks_ = 0;
+                elements_ = 0;
+                start_ = hpx::util::hardware::timestamp();
+
+                return increasing_;
+            }
+
+            std::size_t distance_;
+            std::size_t max_distance_;
+            bool increasing_;
+            std::size_t chunks_;
+            std::size_t elements_;
+            double last_cost_;
+            std::uint64_t start_;
+        };
+
+        // The state of the adaptive mode of a prefetcher_context: the
+        // largest distance the workers may choose (zero if the adaptive mode
+        // is disabled) and the distance learned by the worker which finished
+        // last, which is the starting point of the next invocation.
+        struct adaptive_prefetch_distance
+        {
+            adaptive_prefetch_distance()
+              : max_distance(0), learned(0)
+            {}
+
+            std::size_t max_distance;
+            mutable std::atomic<std::size_t> learned;
+        };
+
+        // The state of the page look-ahead of a prefetcher_context: the
+        // page size (zero if disabled) and the counters of all workers.
+        struct page_lookahead
+        {
+            page_lookahead()
+              : page_size(0), crossings(0), warmings(0)
+            {}
+
+            void add(page_counters const& c) const
+            {
+                if (c.crossings != 0)
+                {
+                    crossings.fetch_add(c.crossings,
+                        std::memory_order_relaxed);
+                    warmings.fetch_add(c.warmings,
+                        std::memory_order_relaxed);
+                }
+            }
+
+            std::size_t page_size;
+            mutable std::atomic<std::size_t> crossings;
+            mutable std::atomic<std::size_t> warmings;
+        };
+
+        ///////////////////////////////////////////////////////////////////////
+        template <typename Itr, typename Containers>
+        struct prefetcher_context;
+
+        //New random access iterator which is used for prefetching
+        //containers within lambda functions. The iterator walks the range
+        //of base iterators chunk by chunk. It is a small, trivially copyable
+        //handle: all shared state (base range, chunk size, containers) lives
+        //in the prefetcher_context it refers to, which therefore has to
+        //outlive all iterators created from it.
+        template <typename Itr, typename Containers>
+        class basic_prefetching_iterator
+        {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = typename std::iterator_traits<Itr>::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = value_type*;
+            using reference = value_type&;
+
+            using base_iterator = Itr;
+            using context_type = prefetcher_context<Itr, Containers>;
+
+            basic_prefetching_iterator() = default;
+
+            explicit basic_prefetching_iterator(std::size_t pos,
+                    context_type const* ctx)
+              : pos_(pos), ctx_(ctx)
+            {}
+
+            // index of the first element of the current chunk, the chunk
+            // boundaries are shifted by the chunk_offset of the context
+            inline std::size_t index() const
+            {
+                return pos_ < ctx_->chunk_offset ? 0 : pos_ - ctx_->chunk_offset;
+            }
+
+            // index of the element following the current chunk
+            inline std::size_t chunk_end() const
+            {
+                std::size_t const last =
+                    pos_ + ctx_->chunk_size - ctx_->chunk_offset;
+                return last < ctx_->range_size ? last : ctx_->range_size;
+            }
+
+            inline context_type const& context() const { return *ctx_; }
+            inline std::size_t chunk_size() const { return ctx_->chunk_size; }
+            inline std::size_t range_size() const { return ctx_->range_size; }
+            inline Containers const& containers() const { return ctx_->m; }
+
+            // iterator referring to the first element of the current chunk
+            inline base_iterator base() const
+            {
+                return ctx_->first + index();
+            }
 
-            explicit prefetching_iterator(std::size_t idx_,base_iterator base_ , std::size_t chunk_size_,
-                std::size_t range_size_, std::vector< T * > const & A)
-            : M_(A), base(base_), chunk_size(chunk_size_), range_size(range_size_), idx(idx_) {}
+            inline basic_prefetching_iterator& operator+=(difference_type rhs)
+            {
+                pos_ += rhs * ctx_->chunk_size;
+                return *this;
+            }
 
-            using difference_type = typename std::iterator<std::random_access_iterator_tag, std::size_t>::difference_type;
+            inline basic_prefetching_iterator& operator-=(difference_type rhs)
+            {
+                pos_ -= rhs * ctx_->chunk_size;
+                return *this;
+            }
 
-            inline prefetching_iterator& operator+=(difference_type rhs)
+            inline basic_prefetching_iterator& operator++()
             {
-                idx = idx + (rhs*chunk_size);
-                base = base + (rhs*chunk_size);
+                pos_ += ctx_->chunk_size;
                 return *this;
             }
 
-            inline prefetching_iterator& operator-=(difference_type rhs)
+            inline basic_prefetching_iterator& operator--()
             {
-                idx = idx - (rhs*chunk_size);
-                base = base - (rhs*chunk_size);
+                pos_ -= ctx_->chunk_size;
                 return *this;
             }
 
-            inline prefetching_iterator& operator++()
-            {
-                idx = idx + chunk_size;
-                base = base + chunk_size;
-                return *this;
+            inline basic_prefetching_iterator operator++(int)
+            {
+                basic_prefetching_iterator tmp(*this);
+                operator++();
+                return tmp;
+            }
+
+            inline basic_prefetching_iterator operator--(int)
+            {
+                basic_prefetching_iterator tmp(*this);
+                operator--();
+                return tmp;
+            }
+
+            inline difference_type
+            operator-(const basic_prefetching_iterator& rhs) const
+            {
+                return (difference_type(pos_) - difference_type(rhs.pos_)) /
+                    difference_type(ctx_->chunk_size);
+            }
+
+            inline basic_prefetching_iterator
+            operator+(difference_type rhs) const
+            {
+                return basic_prefetching_iterator(
+                    pos_ + rhs * ctx_->chunk_size, ctx_);
+            }
+
+            inline basic_prefetching_iterator
+            operator-(difference_type rhs) const
+            {
+                return basic_prefetching_iterator(
+                    pos_ - rhs * ctx_->chunk_size, ctx_);
+            }
+
+            friend inline basic_prefetching_iterator
+            operator+(difference_type lhs,
+                const basic_prefetching_iterator& rhs)
+            {
+                return rhs + lhs;
+            }
+
+            inline bool operator==(const basic_prefetching_iterator& rhs) const
+            {
+                return pos_ == rhs.pos_;
+            }
+            inline bool operator!=(const basic_prefetching_iterator& rhs) const
+            {
+                return pos_ != rhs.pos_;
+            }
+            inline bool operator>(const basic_prefetching_iterator& rhs) const
+            {
+                return pos_ > rhs.pos_;
+            }
+            inline bool operator<(const basic_prefetching_iterator& rhs) const
+            {
+                return pos_ < rhs.pos_;
+            }
+            inline bool operator>=(const basic_prefetching_iterator& rhs) const
+            {
+                return pos_ >= rhs.pos_;
+            }
+            inline bool operator<=(const basic_prefetching_iterator& rhs) const
+            {
+                return pos_ <= rhs.pos_;
+            }
+
+            inline typename std::iterator_traits<Itr>::reference
+            operator*() const
+            {
+                return *base();
+            }
+
+        private:
+            std::size_t pos_;
+            context_type const* ctx_;
+        };
+
+        // The iterator used by the homogeneous (index based) context
+        template <typename T>
+        using prefetching_iterator = basic_prefetching_iterator<
+                boost::counting_iterator<std::size_t>,
+                std::vector<prefetch_container<T> >
+            >;
+
+        //Helper class to initialize prefetching_iterator. Only the bounds of
+        //the base range are stored, construction is O(1) in time and memory.
+        //The chunk size is chosen such that each chunk covers
+        //prefetcher_distance_factor cache lines of the container with the
+        //widest element type. A factor of zero selects chunks of one cache
+        //line and a prefetch distance which is calibrated during the first
+        //invocation (see prefetch_calibration.hpp). The chunks are aligned to
+        //the cache lines of the first (primary) container: the first chunk
+        //is shortened by chunk_offset elements, so that all following chunks
+        //start on a cache-line boundary and chunks (and therefore the
+        //partitions of a parallel loop) never share a cache line of the
+        //primary container. The context is immutable once constructed
+        //(except for the calibrated or learned distance), it is shared by
+        //reference between all iterators created from it.
+        template <typename Itr, typename Containers>
+        struct prefetcher_context
+        {
+            typedef basic_prefetching_iterator<Itr, Containers> iterator;
+
+            Itr first;
+            std::size_t range_size;
+            std::size_t prefetcher_distance_factor;
+            std::size_t line_stride;
+            std::size_t chunk_size;
+            // the number of elements the first chunk is short of chunk_size
+            std::size_t chunk_offset;
+            // number of chunks the prefetches run ahead of the computation,
+            // may be changed before any iteration starts, zero if it is
+            // calibrated during the first invocation
+            std::size_t prefetch_distance;
+            // number of chunks the near level of the containers with a two
+            // level schedule runs ahead
+            std::size_t near_distance;
+            Containers m;
+            // the largest distance for which the prefetched chunks fit into
+            // the share of the L2 cache reserved for data in flight
+            std::size_t max_prefetch_distance;
+            adaptive_prefetch_distance adaptive;
+            // whether the prefetches are issued by helper threads
+            bool helper_thread;
+            // the recorded schedule replayed in inspection mode and the
+            // hint its lines are prefetched with
+            prefetch_schedule* schedule;
+            prefetch_hint schedule_hint;
+            // the number of lines a worker issues per step, zero if the
+            // issue is not limited
+            std::size_t max_outstanding_lines;
+            page_lookahead pages;
+            // whether the prefetches are scaled back while the bandwidth of
+            // the NUMA domain of a worker is saturated
+            bool throttle_bandwidth;
+            // the share of the process-wide prefetch budget, if any
+            prefetch_budget_share* budget;
+
+            explicit prefetcher_context(Itr begin, Itr end,
+                    std::size_t p_factor, Containers const& l)
+              : first(begin), range_size(std::distance(begin, end)),
+                prefetcher_distance_factor(p_factor == 0 ? 1 : p_factor),
+                line_stride(min_line_stride(l)),
+                chunk_size(prefetcher_distance_factor * line_stride),
+                chunk_offset(0), prefetch_distance(p_factor == 0 ? 0 : 1),
+                near_distance(1), m(l), max_prefetch_distance(1),
+                helper_thread(false), schedule(nullptr),
+                schedule_hint(prefetch_hint::t0), max_outstanding_lines(0),
+                throttle_bandwidth(false), budget(nullptr)
+            {
+                align_chunks();
+                limit_footprint(get_cache_topology());
+
+                // the latency is measured here rather than in the timed
+                // sample of the first loop
+                if (prefetch_distance == 0)
+                    calibrate_prefetcher();
+            }
+
+            // iterators refer to the context, so it must stay where it was
+            // created; the factories return it by guaranteed copy elision
+            prefetcher_context(prefetcher_context const&) = delete;
+            prefetcher_context& operator=(prefetcher_context const&) = delete;
+
+            // Make the chunks cover whole cache lines of the primary
+            // container and let them start on cache-line boundaries.
+            void align_chunks()
+            {
+                std::pair<std::size_t, std::size_t> const alignment =
+                    primary_line_alignment(m);
+
+                std::size_t const stride = alignment.first;
+                chunk_size = ((chunk_size + stride - 1) / stride) * stride;
+                chunk_offset = alignment.second;
+            }
+
+            // A chunk should fit into half of the L1 cache, all chunks in
+            // flight into half of the L2 cache.
+            void limit_footprint(cache_topology const& topo)
+            {
+                std::size_t bytes = footprint(m, chunk_size);
+                if (bytes > topo.l1_size / 2 && prefetcher_distance_factor > 1)
+                {
+                    std::size_t const factor =
+                        prefetcher_distance_factor * (topo.l1_size / 2) / bytes;
+                    prefetcher_distance_factor = factor == 0 ? 1 : factor;
+                    chunk_size = prefetcher_distance_factor * line_stride;
+                    align_chunks();
+                    bytes = footprint(m, chunk_size);
+                }
+
+                max_prefetch_distance = std::size_t(-1);
+                if (bytes != 0)
+                {
+                    max_prefetch_distance = (topo.l2_size / 2) / bytes;
+                    if (max_prefetch_distance == 0)
+                        max_prefetch_distance = 1;
+                }
+            }
+
+            // Let the workers tune the prefetch distance while they run,
+            // starting at prefetch_distance and staying within
+            // [1, max_distance] (and below max_prefetch_distance). The
+            // distance learned during one invocation is the starting point
+            // of the next one on this context.
+            void enable_adaptive_distance(std::size_t max_distance = 64)
+            {
+                adaptive.max_distance = max_distance == 0 ? 1 : max_distance;
+            }
+
+            bool adaptive_distance_enabled() const
+            {
+                return adaptive.max_distance != 0;
+            }
+
+            // the distance the next invocation starts with, zero if it has
+            // still to be calibrated
+            std::size_t learned_distance() const
+            {
+                std::size_t d =
+                    adaptive.learned.load(std::memory_order_relaxed);
+                if (d == 0)
+                    d = prefetch_distance;
+                return d < max_prefetch_distance ? d : max_prefetch_distance;
+            }
+
+            void learned_distance(std::size_t d) const
+            {
+                adaptive.learned.store(d, std::memory_order_relaxed);
+            }
+
+            // Leave the regular streams (contiguous accesses, such as the
+            // unit-stride arrays of STREAM) to the hardware prefetcher, only
+            // strided and indirect accesses are prefetched by the context.
+            void enable_prefetch_bypass(bool enable = true)
+            {
+                for_each_container(m,
+                    [=](auto& x)
+                    {
+                        x.bypass_regular_stream(enable);
+                    });
+            }
+
+            // whether the prefetches of each container (in the order given
+            // to make_prefetcher_context) are left to the hardware, for
+            // indirect containers this refers to their index array
+            std::vector<bool> bypassed_containers() const
+            {
+                std::vector<bool> bypassed;
+                for_each_container(m,
+                    [&bypassed](auto const& x)
+                    {
+                        bypassed.push_back(x.bypassed());
+                    });
+                return bypassed;
+            }
+
+            // Translate the pages ahead of the prefetches before they reach
+            // them (see prefetch_container::warm_pages_ahead), page_size has
+            // to match the pages backing the containers, zero disables the
+            // look-ahead.
+            void enable_page_lookahead(std::size_t page_size = 4096)
+            {
+                pages.page_size = page_size;
+            }
+
+            // the number of page boundaries crossed by the look-ahead and
+            // the number of pages translated ahead of the prefetches
+            std::size_t page_crossings() const
+            {
+                return pages.crossings.load(std::memory_order_relaxed);
+            }
+
+            std::size_t page_warmings() const
+            {
+                return pages.warmings.load(std::memory_order_relaxed);
+            }
+
+            HPX_FORCEINLINE void
+            warm_pages_ahead(std::size_t first_idx, std::size_t last_idx,
+                std::size_t ahead) const
+            {
+                page_counters c = { 0, 0 };
+                std::size_t const size = range_size;
+                std::size_t const page_size = pages.page_size;
+                for_each_container(m,
+                    [=, &c](auto const& x)
+                    {
+                        x.warm_pages_ahead(first_idx, last_idx, ahead, size,
+                            page_size, c);
+                    });
+                pages.add(c);
+            }
+
+            // Limit the number of lines a worker issues per step (per line
+            // block of a chunk, or per chunk in chunk-wise loops) to avoid
+            // bursts exceeding the line fill buffers of the core. Lines
+            // beyond the limit are deferred to the following steps, the
+            // streams consumed first are issued first. The prologue of a
+            // loop is not limited.
+            void limit_outstanding_lines(
+                std::size_t max_lines = default_outstanding_lines)
+            {
+                max_outstanding_lines = max_lines;
+            }
+
+            // Scale back the prefetches while the memory bandwidth of the
+            // NUMA domain is saturated (see bandwidth_throttle.hpp). Each
+            // worker uses the throttle of its own domain, shared with the
+            // other loops running there. Not applied while the distance is
+            // calibrated or in helper thread mode.
+            void enable_bandwidth_throttle(bool enable = true)
+            {
+                throttle_bandwidth = enable;
+            }
+
+            // whether the prefetches of the calling worker are throttled
+            bool throttled() const
+            {
+                if (!throttle_bandwidth)
+                    return false;
+
+                bandwidth_throttle const* t =
+                    detail::current_bandwidth_throttle();
+                return t != nullptr && t->throttled();
+            }
+
+            // Share the capacity for data in flight with the other loops
+            // running at the same time (see prefetch_budget.hpp): while
+            // running, the distance is limited to the share of the context.
+            // The share has to outlive the loops. Not applied while the
+            // distance is calibrated or in helper thread mode.
+            void enable_prefetch_budget(prefetch_budget_share& s)
+            {
+                budget = &s;
+            }
+
+            // Let a helper thread on the SMT sibling of each worker issue
+            // the prefetches, staying at most the prefetch distance ahead of
+            // the worker (see prefetch_helper.hpp). Workers whose core has
+            // no sibling which is free of HPX worker threads prefetch by
+            // themselves, so this mode only takes effect with one worker per
+            // core.
+            void enable_helper_thread(bool enable = true)
+            {
+                helper_thread = enable;
+            }
+
+            bool helper_thread_enabled() const
+            {
+                return helper_thread;
+            }
+
+            // Run the loops over this context in inspection mode: the first
+            // pass records the cache lines accessed through record_access()
+            // by each chunk into the given schedule, all following passes
+            // replay them using the given hint. The schedule has to outlive
+            // the loops.
+            void inspect(prefetch_schedule& s,
+                prefetch_hint hint = prefetch_hint::t0)
+            {
+                s.resize(end() - begin());
+                schedule = &s;
+                schedule_hint = hint;
+            }
+
+            // prefetch the elements [first_idx, last_idx)
+            void prefetch(std::size_t first_idx, std::size_t last_idx) const
+            {
+                std::size_t const size = range_size;
+                for_each_container(m,
+                    [=](auto const& x)
+                    {
+                        x.prefetch_ahead(first_idx, last_idx, 0, size);
+                    });
+            }
+
+            // prefetch the elements which are prefetch_distance chunks ahead
+            // of [first_idx, last_idx)
+            HPX_FORCEINLINE void
+            prefetch_ahead(std::size_t first_idx, std::size_t last_idx) const
+            {
+                prefetch_ahead(first_idx, last_idx, learned_distance());
+            }
+
+            // a distance of zero issues no prefetches
+            HPX_FORCEINLINE void
+            prefetch_ahead(std::size_t first_idx, std::size_t last_idx,
+                std::size_t distance) const
+            {
+                if (distance == 0)
+                    return;
+
+                std::size_t const ahead = distance * chunk_size;
+                // the near level is pointless if it isn't closer, it is
+                // dropped while the bandwidth is throttled
+                std::size_t const near =
+                    near_distance < distance && !throttled() ?
+                        near_distance * chunk_size : 0;
+                std::size_t const size = range_size;
+                if (pages.page_size != 0)
+                    warm_pages_ahead(first_idx, last_idx, ahead);
+
+                if (max_outstanding_lines == 0)
+                {
+                    for_each_container(m,
+                        [=](auto const& x)
+                        {
+                            x.prefetch_ahead(first_idx, last_idx, ahead, size);
+                            if (near != 0)
+                                x.prefetch_near(first_idx, last_idx, near, size);
+                        });
+                    return;
+                }
+
+                prefetch_issue_queue& q = prefetch_issue_queue::local();
+                auto push = [&q](void const* p, std::size_t element,
+                    prefetch_hint hint)
+                {
+                    q.push(p, element, hint);
+                };
+                for_each_container(m,
+                    [=, &push](auto const& x)
+                    {
+                        x.prefetch_ahead(first_idx, last_idx, ahead, size,
+                            push);
+                        if (near != 0)
+                            x.prefetch_near(first_idx, last_idx, near, size,
+                                push);
+                    });
+                q.issue(max_outstanding_lines);
+            }
+
+            // the chunks [1, prefetch_distance) following the chunk at
+            // first_idx are not covered by prefetch_ahead, issue those when
+            // starting to work on a new sequence of chunks
+            HPX_FORCEINLINE void
+            prefetch_prologue(std::size_t first_idx) const
+            {
+                prefetch_prologue(first_idx, learned_distance());
+            }
+
+            HPX_FORCEINLINE void
+            prefetch_prologue(std::size_t first_idx,
+                std::size_t distance) const
+            {
+                // lines still queued by a previous loop are stale
+                if (max_outstanding_lines != 0)
+                    prefetch_issue_queue::local().clear();
+
+                std::size_t const ahead = distance * chunk_size;
+                std::size_t const chunk = chunk_end(first_idx) - first_idx;
+                std::size_t const size = range_size;
+                for_each_container(m,
+                    [=](auto const& x)
+                    {
+                        x.prefetch_prologue(first_idx, chunk, ahead, size);
+                    });
+            }
+
+            // the end of the chunk which starts at the element first_idx
+            std::size_t chunk_end(std::size_t first_idx) const
+            {
+                std::size_t const last =
+                    ((first_idx + chunk_offset) / chunk_size + 1) *
+                        chunk_size - chunk_offset;
+                return last < range_size ? last : range_size;
+            }
+
+            iterator begin() const
+            {
+                static_assert(std::is_trivially_copyable<iterator>::value,
+                    "prefetching iterators should be cheap to copy");
+                return iterator(0ul, this);
+            }
+
+            // the end iterator is rounded up to a whole number of chunks, so
+            // that end() - begin() is the exact number of chunks to process
+            iterator end() const
+            {
+                if (range_size == 0)
+                    return begin();
+
+                std::size_t chunks =
+                    (range_size + chunk_offset + chunk_size - 1) / chunk_size;
+                return iterator(chunks * chunk_size, this);
+            }
+        };
+
+        //function which initialize prefetcher_context for containers which
+        //all share the same element type, the iteration runs over the
+        //indices [idx_begin, idx_end)
+        template<typename T>
+        prefetcher_context<
+            boost::counting_iterator<std::size_t>,
+            std::vector<prefetch_container<T> >
+        >
+        make_prefetcher_context(std::size_t idx_begin, std::size_t idx_end,
+            std::initializer_list< T * > &&l, std::size_t p_factor = 0)
+        {
+            typedef boost::counting_iterator<std::size_t> iterator;
+
+            // the containers are addressed relative to the beginning of the
+            // iteration range
+            std::vector<prefetch_container<T> > containers;
+            containers.reserve(l.size());
+            for (T* p: l)
+                containers.push_back(prefetch_container<T>(p + idx_begin));
+
+            return prefetcher_context<iterator, decltype(containers)>(
+                iterator(idx_begin), iterator(idx_end), p_factor, containers);
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Turn the arguments of make_prefetcher_context into container
+        // descriptors: pointers, contiguous containers (exposing data()),
+        // and descriptors created by make_prefetch_container are accepted.
+        template <typename T>
+        HPX_FORCEINLINE prefetch_container<T>
+        to_prefetch_container(T* p)
+        {
+            return prefetch_container<T>(p);
+        }
+
+        template <typename T>
+        HPX_FORCEINLINE prefetch_container<T>
+        to_prefetch_container(prefetch_container<T> const& c)
+        {
+            return c;
+        }
+
+        template <typename T, typename Index>
+        HPX_FORCEINLINE indirect_prefetch_container<T, Index>
+        to_prefetch_container(indirect_prefetch_container<T, Index> const& c)
+        {
+            return c;
+        }
+
+        template <typename Rng>
+        HPX_FORCEINLINE auto to_prefetch_container(Rng& rng)
+        ->  prefetch_container<
+                typename std::remove_pointer<decltype(rng.data())>::type>
+        {
+            return prefetch_container<
+                    typename std::remove_pointer<decltype(rng.data())>::type
+                >(rng.data());
+        }
+
+        template <typename Rng>
+        struct prefetch_container_type
+        {
+            typedef typename std::decay<
+                    decltype(to_prefetch_container(std::declval<Rng&>()))
+                >::type type;
+        };
+
+        // the element type of a container (or pointer)
+        template <typename Rng>
+        struct container_value
+        {
+            typedef typename prefetch_container_type<Rng>::type::value_type
+                type;
+        };
+
+        template <typename Index, typename ... Ts, std::size_t ... Is>
+        std::tuple<indirect_prefetch_container<
+            typename container_value<Ts>::type,
+            typename container_value<Index>::type>...>
+        make_indirect_containers(Index& index, std::index_sequence<Is...>,
+            Ts & ... rngs)
+        {
+            typedef typename container_value<Index>::type index_type;
+
+            // only the first of the containers prefetches the index array
+            return std::make_tuple(
+                indirect_prefetch_container<
+                        typename container_value<Ts>::type, index_type
+                    >(to_prefetch_container(index).data_,
+                        to_prefetch_container(rngs).data_,
+                        prefetch_hint::t0, Is == 0)...);
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // The set of containers of a prefetcher_context whose prefetch
+        // distance, chunk size and container types are compile-time
+        // constants. The containers are accessed contiguously (element i of
+        // each container while processing element i of the base range), the
+        // line size is HPX_PREFETCH_LINE_SIZE.
+        template <std::size_t Distance, std::size_t LinesPerChunk,
+            typename ... Ts>
+        struct static_prefetch_containers
+        {
+            static_assert(Distance != 0 && LinesPerChunk != 0,
+                "the distance and the chunk size have to be non-zero");
+            static_assert(sizeof...(Ts) != 0,
+                "at least one container has to be prefetched");
+
+            static constexpr std::size_t line_size = HPX_PREFETCH_LINE_SIZE;
+
+            // number of elements per cache line of the container with the
+            // widest element type
+            static constexpr std::size_t line_stride = (std::min)({
+                    (sizeof(Ts) < line_size ? line_size / sizeof(Ts) : 1)...
+                });
+            static constexpr std::size_t chunk_size =
+                LinesPerChunk * line_stride;
+            static constexpr std::size_t distance = Distance;
+
+            explicit static_prefetch_containers(
+                    prefetch_container<Ts> const& ... c)
+              : containers_(prefetch_container<Ts>(c.data_, c.hint_, 1, 0,
+                    1, line_size)...)
+            {}
+
+            // prefetch the line_stride elements starting at idx of all
+            // containers, the number of prefetches issued for each of the
+            // containers is a compile-time constant
+            HPX_FORCEINLINE void prefetch_block(std::size_t idx) const
+            {
+                prefetch_block(idx, std::index_sequence_for<Ts...>());
+            }
+
+            std::tuple<prefetch_container<Ts>...> containers_;
+
+        private:
+            template <typename T>
+            static HPX_FORCEINLINE void
+            prefetch_block(prefetch_container<T> const& c, std::size_t idx)
+            {
+                std::size_t const lines =
+                    (line_stride * sizeof(T) + line_size - 1) / line_size;
+
+                char const* p = reinterpret_cast<char const*>(c.data_ + idx);
+                for (std::size_t k = 0; k != lines; ++k)
+                    prefetch_address(p + k * line_size, c.hint_);
+            }
+
+            template <std::size_t ... Is>
+            HPX_FORCEINLINE void
+            prefetch_block(std::size_t idx, std::index_sequence<Is...>) const
+            {
+                int const sequencer[] = {
+                    0, (prefetch_block(std::get<Is>(containers_), idx), 0)...
+                };
+                (void)sequencer;
+            }
+        };
+
+        template <std::size_t Distance, std::size_t LinesPerChunk,
+            typename ... Ts>
+        constexpr std::size_t
+        static_prefetch_containers<Distance, LinesPerChunk, Ts...>::line_size;
+
+        template <std::size_t Distance, std::size_t LinesPerChunk,
+            typename ... Ts>
+        constexpr std::size_t
+        static_prefetch_containers<Distance, LinesPerChunk, Ts...>::line_stride;
+
+        template <std::size_t Distance, std::size_t LinesPerChunk,
+            typename ... Ts>
+        constexpr std::size_t
+        static_prefetch_containers<Distance, LinesPerChunk, Ts...>::chunk_size;
+
+        template <std::size_t Distance, std::size_t LinesPerChunk,
+            typename ... Ts>
+        constexpr std::size_t
+        static_prefetch_containers<Distance, LinesPerChunk, Ts...>::distance;
+
+        // The compile-time specialized prefetcher_context. It exposes the
+        // same interface as the generic one, the loops recognize it and run
+        // an unrolled chunk body (see prefetching_loop_n below). The
+        // distance is fixed, neither calibration nor the adaptive mode are
+        // supported.
+        template <typename Itr, std::size_t Distance,
+            std::size_t LinesPerChunk, typename ... Ts>
+        struct prefetcher_context<Itr,
+            static_prefetch_containers<Distance, LinesPerChunk, Ts...> >
+        {
+            typedef static_prefetch_containers<Distance, LinesPerChunk, Ts...>
+                containers_type;
+            typedef basic_prefetching_iterator<Itr, containers_type> iterator;
+
+            Itr first;
+            std::size_t range_size;
+            std::size_t prefetcher_distance_factor;
+            std::size_t line_stride;
+            std::size_t chunk_size;
+            std::size_t chunk_offset;
+            std::size_t prefetch_distance;
+            containers_type m;
+
+            // the chunks are aligned to the cache lines of the primary
+            // container if they cover whole lines of it
+            explicit prefetcher_context(Itr begin, Itr end,
+                    containers_type const& l)
+              : first(begin), range_size(std::distance(begin, end)),
+                prefetcher_distance_factor(LinesPerChunk),
+                line_stride(containers_type::line_stride),
+                chunk_size(containers_type::chunk_size),
+                chunk_offset(0), prefetch_distance(Distance), m(l)
+            {
+                std::pair<std::size_t, std::size_t> const alignment =
+                    primary_line_alignment(m.containers_);
+                if (chunk_size % alignment.first == 0)
+                    chunk_offset = alignment.second;
+            }
+
+            prefetcher_context(prefetcher_context const&) = delete;
+            prefetcher_context& operator=(prefetcher_context const&) = delete;
+
+            std::size_t learned_distance() const { return Distance; }
+
+            HPX_FORCEINLINE void
+            prefetch_ahead(std::size_t first_idx, std::size_t last_idx,
+                std::size_t distance = Distance) const
+            {
+                std::size_t const ahead = distance * chunk_size;
+                std::size_t const size = range_size;
+                for_each_container(m.containers_,
+                    [=](auto const& x)
+                    {
+                        x.prefetch_ahead(first_idx, last_idx, ahead, size);
+                    });
+            }
+
+            HPX_FORCEINLINE void
+            prefetch_prologue(std::size_t first_idx,
+                std::size_t distance = Distance) const
+            {
+                std::size_t const ahead = distance * chunk_size;
+                std::size_t const chunk = chunk_end(first_idx) - first_idx;
+                std::size_t const size = range_size;
+                for_each_container(m.containers_,
+                    [=](auto const& x)
+                    {
+                        x.prefetch_prologue(first_idx, chunk, ahead, size);
+                    });
+            }
+
+            iterator begin() const
+            {
+                static_assert(std::is_trivially_copyable<iterator>::value,
+                    "prefetching iterators should be cheap to copy");
+                return iterator(0ul, this);
+            }
+
+            std::size_t chunk_end(std::size_t first_idx) const
+            {
+                std::size_t const last =
+                    ((first_idx + chunk_offset) / chunk_size + 1) *
+                        chunk_size - chunk_offset;
+                return last < range_size ? last : range_size;
+            }
+
+            iterator end() const
+            {
+                if (range_size == 0)
+                    return begin();
+
+                std::size_t chunks =
+                    (range_size + chunk_offset + chunk_size - 1) / chunk_size;
+                return iterator(chunks * chunk_size, this);
+            }
+        };
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Create the descriptor for a container (or pointer) which is prefetched
+    // using the given hint.
+    template <typename Rng>
+    typename detail::prefetch_container_type<Rng>::type
+    make_prefetch_container(Rng& rng, prefetch_hint hint)
+    {
+        typename detail::prefetch_container_type<Rng>::type c =
+            detail::to_prefetch_container(rng);
+        c.hint_ = hint;
+        return c;
+    }
+
+    template <typename T>
+    detail::prefetch_container<T>
+    make_prefetch_container(T* p, prefetch_hint hint)
+    {
+        return detail::prefetch_container<T>(p, hint);
+    }
+
+    // Create the descriptor for a container (or pointer, or from another
+    // descriptor) which is prefetched in two levels: far_hint is used for
+    // the prefetch distance of the context (to hide the memory latency
+    // without polluting the L1 cache), near_hint for the near_distance of
+    // the context (to move the lines to the L1 cache just in time).
+    template <typename Rng>
+    typename detail::prefetch_container_type<
+        typename std::remove_reference<Rng>::type
+    >::type
+    make_two_level_prefetch_container(Rng && rng,
+        prefetch_hint far_hint = prefetch_hint::t1,
+        prefetch_hint near_hint = prefetch_hint::t0)
+    {
+        typename detail::prefetch_container_type<
+                typename std::remove_reference<Rng>::type
+            >::type c = detail::to_prefetch_container(rng);
+        c.hint_ = far_hint;
+        c.near_hint_ = near_hint;
+        return c;
+    }
+
+    // Create the descriptor for a container of which the elements
+    // [stride*i + offset, stride*i + offset + width) are accessed while
+    // processing element i of the base range, e.g. a field of an array of
+    // structs or one component of an interleaved xyz array.
+    template <typename Rng>
+    typename detail::prefetch_container_type<Rng>::type
+    make_strided_prefetch_container(Rng& rng, std::size_t stride,
+        std::size_t offset = 0, std::size_t width = 1,
+        prefetch_hint hint = prefetch_hint::t0)
+    {
+        typedef typename detail::prefetch_container_type<Rng>::type
+            container_type;
+        return container_type(detail::to_prefetch_container(rng).data_,
+            hint, stride, offset, width);
+    }
+
+    // Create the descriptor for a container which is accessed as
+    // data[index[i]] while processing element i of the base range.
+    template <typename Index, typename Rng>
+    detail::indirect_prefetch_container<
+        typename detail::container_value<Rng>::type,
+        typename detail::container_value<Index>::type>
+    make_indirect_prefetch_container(Index& index, Rng& data,
+        prefetch_hint hint = prefetch_hint::t0)
+    {
+        return detail::indirect_prefetch_container<
+                typename detail::container_value<Rng>::type,
+                typename detail::container_value<Index>::type
+            >(detail::to_prefetch_container(index).data_,
+                detail::to_prefetch_container(data).data_, hint);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Create a prefetcher_context iterating over [base_begin, base_end)
+    // while prefetching the elements of all given containers. The
+    // containers may have arbitrary (and differing) element types, they can
+    // be given as contiguous containers (exposing data()), as pointers, or
+    // as descriptors created by make_prefetch_container. Element i of each
+    // container is expected to be accessed while processing the i-th
+    // element of the base range.
+    template <typename Itr, typename ... Ts>
+    detail::prefetcher_context<Itr,
+        std::tuple<typename detail::prefetch_container_type<Ts>::type...>
+    >
+    make_prefetcher_context(Itr base_begin, Itr base_end,
+        std::size_t p_factor, Ts && ... rngs)
+    {
+        typedef std::tuple<
+                typename detail::prefetch_container_type<Ts>::type...
+            > containers_type;
+
+        return detail::prefetcher_context<Itr, containers_type>(
+            base_begin, base_end, p_factor,
+            containers_type(detail::to_prefetch_container(rngs)...));
+    }
+
+    // Create a prefetcher_context for irregular loops of the form
+    // x[index[i]]: all given containers are gathered through the same index
+    // array while iterating over [base_begin, base_end).
+    template <typename Itr, typename Index, typename ... Ts>
+    detail::prefetcher_context<Itr,
+        std::tuple<detail::indirect_prefetch_container<
+            typename detail::container_value<Ts>::type,
+            typename detail::container_value<Index>::type>...>
+    >
+    make_indirect_prefetcher_context(Itr base_begin, Itr base_end,
+        std::size_t p_factor, Index& index, Ts & ... rngs)
+    {
+        auto containers = detail::make_indirect_containers(index,
+            std::index_sequence_for<Ts...>(), rngs...);
+
+        return detail::prefetcher_context<Itr, decltype(containers)>(
+            base_begin, base_end, p_factor, containers);
+    }
+
+    // Create a prefetcher_context whose prefetch distance (in chunks), chunk
+    // size (in cache lines) and set of containers are compile-time
+    // constants, which allows the loops to run an unrolled chunk body. The
+    // containers can be given in the same ways as for
+    // make_prefetcher_context, only their prefetch hints are used though
+    // (all containers are accessed contiguously).
+    template <std::size_t Distance, std::size_t LinesPerChunk, typename Itr,
+        typename ... Ts>
+    detail::prefetcher_context<Itr,
+        detail::static_prefetch_containers<Distance, LinesPerChunk,
+            typename detail::container_value<Ts>::type...>
+    >
+    make_static_prefetcher_context(Itr base_begin, Itr base_end,
+        Ts && ... rngs)
+    {
+        typedef detail::static_prefetch_containers<Distance, LinesPerChunk,
+                typename detail::container_value<Ts>::type...
+            > containers_type;
+
+        return detail::prefetcher_context<Itr, containers_type>(
+            base_begin, base_end,
+            containers_type(detail::to_prefetch_container(rngs)...));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    namespace detail
+    {
+        // Helper class to repeatedly call a function a given number of times
+        // starting from a given iterator position.
+        template <typename Iterator>
+        struct loop_n
+        {
+            ///////////////////////////////////////////////////////////////////
+            // handle sequences of non-futures
+            template <typename Iter, typename F>
+            static Iter call(Iter it, std::size_t count, F && f)
+            {
+                for (/**/; count != 0; (void) --count, ++it)
+                    f(it);
+                return it;
+            }
+
+            template <typename Iter, typename CancelToken, typename F>
+            static Iter call(Iter it, std::size_t count, CancelToken& tok,
+                F && f)
+            {
+                for (/**/; count != 0; (void) --count, ++it)
+                {
+                    if (tok.was_cancelled())
+                        break;
+                    f(it);
+                }
+                return it;
+            }
+        };
+
+        ///////////////////////////////////////////////////////////////////////
+        // Call f for the base iterators of the elements [j, last) of a chunk
+        // while spreading the prefetches for the chunk which is 'distance'
+        // chunks ahead over its iterations, one cache line at a time.
+        // Returns false if f asked to stop the iteration.
+        template <typename Context, typename Itr, typename F>
+        HPX_FORCEINLINE bool
+        prefetching_chunk(Context const& ctx, Itr inner_it, std::size_t j,
+            std::size_t last, std::size_t distance, F & f)
+        {
+            std::size_t const line_stride = ctx.line_stride;
+            while (j < last)
+            {
+                std::size_t line_end = j + line_stride;
+                if (last < line_end)
+                    line_end = last;
+
+                ctx.prefetch_ahead(j, line_end, distance);
+
+                for (/**/; j < line_end; ++j)
+                {
+                    if (!f(inner_it))
+                        return false;
+                    ++inner_it;
+                }
+            }
+            return true;
+        }
+
+        // The adaptive variant of prefetching_chunks_n: the distance is tuned
+        // by the worker while running, the result is stored in the context.
+        template <typename Itr, typename Containers, typename Body>
+        basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n_adaptive(
+            basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body & body)
+        {
+            auto const& ctx = it.context();
+
+            std::size_t max_distance = ctx.adaptive.max_distance;
+            if (ctx.max_prefetch_distance < max_distance)
+                max_distance = ctx.max_prefetch_distance;
+
+            prefetch_distance_tuner tuner(ctx.learned_distance(),
+                max_distance);
+
+            ctx.prefetch_prologue(it.index(), tuner.distance());
+
+            for (/**/; count != 0; (void) --count, ++it)
+            {
+                std::size_t first = it.index();
+                std::size_t last = it.chunk_end();
+
+                if (!body(first, last, tuner.distance()))
+                    break;
+
+                // the chunk skipped when increasing the distance is
+                // prefetched in addition to the regular one
+                if (tuner.chunk_done(last - first))
+                    ctx.prefetch_ahead(first, last, tuner.distance());
+            }
+
+            ctx.learned_distance(tuner.distance());
+            return it;
+        }
+
+        // The variant of prefetching_chunks_n used as long as the distance
+        // of the context has not been calibrated: the kernel is timed over
+        // a sample of chunks which are prefetched using the largest
+        // calibrated distance, the remaining chunks use the distance derived
+        // from the measurement.
+        template <typename Itr, typename Containers, typename Body>
+        basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n_calibrating(
+            basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body & body)
+        {
+            auto const& ctx = it.context();
+            std::size_t const sample_end =
+                calibration_skip_chunks + calibration_chunks;
+
+            std::size_t distance = max_calibrated_distance;
+            if (ctx.max_prefetch_distance < distance)
+                distance = ctx.max_prefetch_distance;
+            ctx.prefetch_prologue(it.index(), distance);
+
+            std::uint64_t start = 0;
+            std::size_t elements = 0;
+            for (std::size_t chunk = 0; count != 0;
+                 (void) --count, ++it, ++chunk)
+            {
+                std::size_t first = it.index();
+                std::size_t last = it.chunk_end();
+
+                if (chunk == calibration_skip_chunks)
+                    start = hpx::util::hardware::timestamp();
+
+                if (!body(first, last, distance))
+                    break;
+
+                if (chunk >= calibration_skip_chunks && chunk < sample_end)
+                {
+                    elements += last - first;
+                    if (chunk + 1 == sample_end)
+                    {
+                        distance = calibrated_prefetch_distance(
+                            hpx::util::hardware::timestamp() - start,
+                            elements, ctx.chunk_size);
+                        ctx.learned_distance(distance);
+                        distance = ctx.learned_distance();
+                    }
+                }
+            }
+            return it;
+        }
+
+        // The variant of prefetching_chunks_n used in helper thread mode:
+        // body is called with a distance of zero (no prefetches are issued
+        // by the worker), the worker only publishes its progress to the
+        // helper thread which issues the prefetches for the following
+        // chunks. Falls back to the regular schedule if the worker has no
+        // helper thread.
+        template <typename Itr, typename Containers, typename Body>
+        basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n_helper(
+            basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body & body, std::size_t distance)
+        {
+            typedef typename basic_prefetching_iterator<Itr, Containers>::
+                context_type context_type;
+
+            auto const& ctx = it.context();
+            prefetch_helper_thread* helper = get_prefetch_helper();
+            if (helper == nullptr)
+            {
+                ctx.prefetch_prologue(it.index(), distance);
+                for (/**/; count != 0; (void) --count, ++it)
+                {
+                    if (!body(it.index(), it.chunk_end(), distance))
+                        break;
+                }
+                return it;
+            }
+
+            std::size_t last = (it + count).index();
+            if (ctx.range_size < last)
+                last = ctx.range_size;
+
+            prefetch_job job(&prefetch_context_range<context_type>, &ctx,
+                it.index(), last, ctx.chunk_size, distance * ctx.chunk_size);
+            prefetch_helper_scope scope(*helper, job);
+
+            for (/**/; count != 0; (void) --count, ++it)
+            {
+                std::size_t first = it.index();
+                scope.progress(first);
+
+                if (!body(first, it.chunk_end(), 0))
+                    break;
+            }
+            return it;
+        }
+
+        // The variants of prefetching_chunks_n selected by the mode of the
+        // context.
+        template <typename Itr, typename Containers, typename Body>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n_dispatch(
+            basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body & body)
+        {
+            auto const& ctx = it.context();
+            std::size_t const distance = ctx.learned_distance();
+            if (distance == 0)
+                return prefetching_chunks_n_calibrating(it, count, body);
+            if (ctx.helper_thread_enabled())
+                return prefetching_chunks_n_helper(it, count, body, distance);
+            if (ctx.adaptive_distance_enabled())
+                return prefetching_chunks_n_adaptive(it, count, body);
+
+            ctx.prefetch_prologue(it.index(), distance);
+
+            for (/**/; count != 0; (void) --count, ++it)
+            {
+                std::size_t first = it.index();
+                std::size_t last = it.chunk_end();
+
+                if (!body(first, last, distance))
+                    return it;
+            }
+
+            return it;
+        }
+
+        // Wraps the chunk body of a loop running over an inspected context:
+        // chunks which have not been recorded yet are run while recording
+        // their accesses, the recorded lines of the chunks up to distance
+        // chunks ahead are prefetched before running a chunk.
+        template <typename Context, typename Body>
+        class inspecting_chunk_body
+        {
+        public:
+            inspecting_chunk_body(Context const& ctx, Body& body)
+              : ctx_(ctx), body_(body), next_(0)
+            {}
+
+            bool operator()(std::size_t first, std::size_t last,
+                std::size_t distance)
+            {
+                prefetch_schedule& schedule = *ctx_.schedule;
+                std::size_t const chunk =
+                    (first + ctx_.chunk_offset) / ctx_.chunk_size;
+
+                // the schedule was sized for a different range
+                if (chunk >= schedule.size())
+                    return body_(first, last, distance);
+
+                // the helper thread mode runs the body with a distance of
+                // zero, the worker replays the recorded lines nevertheless
+                std::size_t const ahead =
+                    distance != 0 ? distance : ctx_.learned_distance();
+
+                // the first chunk of a sequence hasn't been prefetched by a
+                // previous one, its lines are replayed as well
+                prefetch_hint const hint = ctx_.schedule_hint;
+                if (next_ < chunk)
+                    next_ = chunk;
+                for (/**/; next_ <= chunk + ahead; ++next_)
+                {
+                    schedule.replay(next_,
+                        [hint](void const* p)
+                        {
+                            prefetch_address(p, hint);
+                        });
+                }
+
+                if (schedule.recorded(chunk))
+                    return body_(first, last, distance);
+
+                prefetch_schedule::recording r(schedule, chunk);
+                if (!body_(first, last, distance))
+                    return false;
+
+                r.commit();
+                return true;
             }
 
-            inline prefetching_iterator& operator--()
-            {
-                idx = idx - chunk_size;
-                base = base - chunk_size;
-                return *this;
-            }
+        private:
+            Context const& ctx_;
+            Body& body_;
+            std::size_t next_;
+        };
 
-            inline prefetching_iterator operator++(int)
+        // Wraps the chunk body of a loop running over a context with the
+        // bandwidth throttle enabled: the distance is scaled back by the
+        // throttle of the worker's NUMA domain, the bytes of the containers
+        // covered by each chunk are reported to it once the chunk is done
+        // (collected by the worker and passed on every few chunks, see
+        // bandwidth_throttle::reporter). The throttle is made the current
+        // one of the worker for as long as it runs the chunks.
+        template <typename Context, typename Body>
+        class throttled_chunk_body
+        {
+        public:
+            throttled_chunk_body(Context const& ctx, Body& body)
+              : ctx_(ctx), body_(body),
+                chunk_bytes_(footprint(ctx.m, ctx.chunk_size)),
+                throttle_(get_worker_bandwidth_throttle()),
+                reporter_(throttle_),
+                previous_(current_bandwidth_throttle())
             {
-                prefetching_iterator tmp(*this);
-                operator++();
-                return tmp;
+                current_bandwidth_throttle() = &throttle_;
             }
 
-            inline prefetching_iterator operator--(int)
+            ~throttled_chunk_body()
             {
-                prefetching_iterator tmp(*this);
-                operator--();
-                return tmp;
+                current_bandwidth_throttle() = previous_;
             }
 
-            inline difference_type operator-(const prefetching_iterator& rhs) const
-            {
-                return (idx-rhs.idx)/chunk_size;
-            }
+            throttled_chunk_body(throttled_chunk_body const&) = delete;
+            throttled_chunk_body& operator=(
+                throttled_chunk_body const&) = delete;
 
-            inline prefetching_iterator operator+(difference_type rhs) const
+            bool operator()(std::size_t first, std::size_t last,
+                std::size_t distance)
             {
-                return prefetching_iterator((idx+(rhs*chunk_size)),(base+(rhs*chunk_size)),chunk_size,range_size,M_);
-            }
+                if (!body_(first, last, throttle_.distance(distance)))
+                    return false;
 
-            inline prefetching_iterator operator-(difference_type rhs) const
-            {
-                return prefetching_iterator((idx-(rhs*chunk_size)),(base-(rhs*chunk_size)),chunk_size,range_size,M_);
+                reporter_.retire(footprint(ctx_.m, last - first),
+                    distance * chunk_bytes_);
+                return true;
             }
 
-            friend inline prefetching_iterator operator+(difference_type lhs, const prefetching_iterator& rhs)
+        private:
+            Context const& ctx_;
+            Body& body_;
+            std::size_t chunk_bytes_;
+            bandwidth_throttle& throttle_;
+            bandwidth_throttle::reporter reporter_;
+            bandwidth_throttle* previous_;
+        };
+
+        // Wraps the chunk body of a loop running over a context sharing the
+        // prefetch budget: the context is active while the body is alive,
+        // the distance is limited to the share of the context. The bytes
+        // retired by the worker are reported to the share when it is done.
+        template <typename Context, typename Body>
+        class budgeted_chunk_body
+        {
+        public:
+            budgeted_chunk_body(Context const& ctx, Body& body)
+              : ctx_(ctx), body_(body),
+                chunk_bytes_(footprint(ctx.m, ctx.chunk_size)), bytes_(0),
+                start_(hpx::util::hardware::timestamp())
             {
-                return rhs + lhs;
+                ctx_.budget->enter();
             }
 
-            friend inline prefetching_iterator operator-(difference_type lhs, const prefetching_iterator& rhs)
+            ~budgeted_chunk_body()
             {
-                return lhs - rhs;
+                ctx_.budget->leave(bytes_,
+                    hpx::util::hardware::timestamp() - start_);
             }
 
+            budgeted_chunk_body(budgeted_chunk_body const&) = delete;
+            budgeted_chunk_body& operator=(
+                budgeted_chunk_body const&) = delete;
+
+            bool operator()(std::size_t first, std::size_t last,
+                std::size_t distance)
+            {
+                std::size_t const max_distance =
+                    ctx_.budget->max_distance(chunk_bytes_);
+                if (max_distance < distance)
+                    distance = max_distance;
 
-            inline bool operator==(const prefetching_iterator& rhs) const {return idx == rhs.idx;}
-            inline bool operator!=(const prefetching_iterator& rhs) const {return idx != rhs.idx;}
-            inline bool operator>(const prefetching_iterator& rhs) const {return idx > rhs.idx;}
-            inline bool operator<(const prefetching_iterator& rhs) const {return idx < rhs.idx;}
-            inline bool operator>=(const prefetching_iterator& rhs) const {return idx >= rhs.idx;}
-            inline bool operator<=(const prefetching_iterator& rhs) const {return idx <= rhs.idx;}
+                if (!body_(first, last, distance))
+                    return false;
 
+                bytes_ += footprint(ctx_.m, last - first);
+                return true;
+            }
 
-            inline std::size_t operator*() const {return idx;}
+        private:
+            Context const& ctx_;
+            Body& body_;
+            std::size_t chunk_bytes_;
+            std::size_t bytes_;
+            std::uint64_t start_;
         };
 
-
-        //Helper class to initialize prefetching_iterator
-        template<typename T>
-        struct prefetcher_context
+        template <typename Itr, typename Containers, typename Body>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n_inspecting(
+            basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body & body)
         {
-            std::vector<std::size_t> range;
-            std::vector<std::size_t>::iterator it_begin;
-            std::vector<std::size_t>::iterator it_end;
-            std::size_t prefetcher_distance_factor;
-            std::size_t chunk_size;
-            std::vector< T * > m;
-            std::size_t range_size;
+            typedef typename basic_prefetching_iterator<Itr, Containers>::
+                context_type context_type;
 
-
-            explicit prefetcher_context (std::size_t begin, std::size_t end,
-                std::size_t p_factor, std::initializer_list< T * > &&l)
+            auto const& ctx = it.context();
+            if (ctx.schedule != nullptr)
             {
-                std::size_t vector_size = end - begin;
-                range.resize(vector_size);
-                for(std::size_t i=0; i<vector_size; ++i) range[i]=i;
-                it_begin = range.begin();
-                it_end = range.end() - 1;
-                prefetcher_distance_factor = p_factor;
-                chunk_size = p_factor * 64 / sizeof(T);
-                m = l;
-                range_size = vector_size;
+                inspecting_chunk_body<context_type, Body> inspecting(ctx, body);
+                return prefetching_chunks_n_dispatch(it, count, inspecting);
             }
+            return prefetching_chunks_n_dispatch(it, count, body);
+        }
 
-            explicit prefetcher_context (std::size_t begin, std::size_t end,
-                std::initializer_list< T * > &&l)
-            {
-                std::size_t vector_size = end - begin;
-                range.resize(vector_size);
-                for(std::size_t i=0; i<vector_size; ++i) range[i] = i + begin;
-                it_begin = range.begin();
-                it_end = range.begin() + vector_size - 1;
-                chunk_size = 64 / sizeof(T);
-                m = l;
-                range_size = vector_size;
-            }
+        template <typename Itr, typename Containers, typename Body>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n_throttled(
+            basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body & body)
+        {
+            typedef typename basic_prefetching_iterator<Itr, Containers>::
+                context_type context_type;
 
-            prefetching_iterator<T> begin()
+            auto const& ctx = it.context();
+            if (ctx.throttle_bandwidth)
             {
-                return prefetching_iterator<T>(0ul, it_begin, chunk_size, range_size, m);
+                throttled_chunk_body<context_type, Body> throttled(ctx, body);
+                return prefetching_chunks_n_inspecting(it, count, throttled);
             }
+            return prefetching_chunks_n_inspecting(it, count, body);
+        }
+
+        // Run the prefetching schedule over the count chunks starting at it,
+        // body(first, last, distance) is called for each of them, where
+        // [first, last) are the positions of the chunk's elements in the base
+        // range and distance is the number of chunks to prefetch ahead. The
+        // iteration stops early if body returns false. Returns the iterator
+        // referring to the chunk the iteration stopped in.
+        template <typename Itr, typename Containers, typename Body>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr, Containers>
+        prefetching_chunks_n(basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, Body && body)
+        {
+            typedef typename basic_prefetching_iterator<Itr, Containers>::
+                context_type context_type;
 
-            prefetching_iterator<T> end()
+            if (count == 0)
+                return it;
+
+            auto const& ctx = it.context();
+            if (ctx.learned_distance() == 0 || ctx.helper_thread_enabled())
+                return prefetching_chunks_n_inspecting(it, count, body);
+
+            if (ctx.budget != nullptr)
             {
-                return prefetching_iterator<T>(std::distance(it_begin, it_end + 1) , it_end, chunk_size, range_size, m);
+                budgeted_chunk_body<context_type,
+                        typename std::remove_reference<Body>::type
+                    > budgeted(ctx, body);
+                return prefetching_chunks_n_throttled(it, count, budgeted);
             }
+            return prefetching_chunks_n_throttled(it, count, body);
+        }
 
-        };
+        // Run the prefetching schedule over the count chunks starting at it
+        // and call f with the base iterator of each of their elements. The
+        // iteration stops early if f returns false.
+        template <typename Itr, typename Containers, typename F>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr, Containers>
+        prefetching_loop_n(basic_prefetching_iterator<Itr, Containers> it,
+            std::size_t count, F && f)
+        {
+            if (count == 0)
+                return it;
 
+            auto const& ctx = it.context();
+            return prefetching_chunks_n(it, count,
+                [&ctx, &f](std::size_t first, std::size_t last,
+                    std::size_t distance) -> bool
+                {
+                    return prefetching_chunk(ctx, ctx.first + first, first,
+                        last, distance, f);
+                });
+        }
 
-        //function which initialize prefetcher_context
-        template<typename T>
-        prefetcher_context<T> make_prefetcher_context(std::size_t idx_begin, std::size_t idx_end,
-            std::initializer_list< T * > &&l, std::size_t p_factor = 0)
+        ///////////////////////////////////////////////////////////////////////
+        // The chunks of a compile-time specialized context: all complete
+        // chunks whose prefetched chunk lies inside of the base range run a
+        // body without any range checks, in which the number of iterations
+        // and of prefetches is known at compile time. The (shortened) first
+        // chunk and the chunks at the end of the range use the generic
+        // schedule.
+        template <typename Itr, std::size_t Distance,
+            std::size_t LinesPerChunk, typename ... Ts, typename F>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr,
+            static_prefetch_containers<Distance, LinesPerChunk, Ts...> >
+        prefetching_loop_n(basic_prefetching_iterator<Itr,
+                static_prefetch_containers<Distance, LinesPerChunk, Ts...>
+            > it, std::size_t count, F && f)
         {
-            if(p_factor == 0)
-                return prefetcher_context<T>(idx_begin, idx_end, std::move(l));
-            else
-                return prefetcher_context<T>(idx_begin, idx_end, p_factor, std::move(l));
-        }
+            typedef static_prefetch_containers<Distance, LinesPerChunk, Ts...>
+                containers_type;
 
+            std::size_t const chunk_size = containers_type::chunk_size;
+            std::size_t const line_stride = containers_type::line_stride;
+            std::size_t const ahead = Distance * chunk_size;
 
-        // Helper class to repeatedly call a function a given number of times
-        // starting from a given iterator position.
-        template <typename Iterator>
-        struct loop_n
-        {
-            ///////////////////////////////////////////////////////////////////
-            // handle sequences of non-futures
-            template <typename Iter, typename F>
-            static Iter call(Iter it, std::size_t count, F && f)
-            {
-                for (/**/; count != 0; (void) --count, ++it)
-                    f(it);
+            if (count == 0)
                 return it;
-            }
 
-            template <typename Iter, typename CancelToken, typename F>
-            static Iter call(Iter it, std::size_t count, CancelToken& tok,
-                F && f)
+            auto const& ctx = it.context();
+            std::size_t const range_size = ctx.range_size;
+
+            ctx.prefetch_prologue(it.index());
+
+            for (/**/; count != 0; (void) --count, ++it)
             {
-                for (/**/; count != 0; (void) --count, ++it)
+                std::size_t const first = it.index();
+                std::size_t const last = it.chunk_end();
+
+                if (last - first != chunk_size ||
+                    range_size < last + ahead)
                 {
-                    if (tok.was_cancelled())
-                        break;
-                    f(it);
+                    if (!prefetching_chunk(ctx, ctx.first + first, first,
+                            last, Distance, f))
+                    {
+                        return it;
+                    }
+                    continue;
+                }
+
+                Itr inner_it = ctx.first + first;
+                for (std::size_t l = 0; l != LinesPerChunk; ++l)
+                {
+                    ctx.m.prefetch_block(first + ahead + l * line_stride);
+                    for (std::size_t j = 0; j != line_stride; ++j)
+                    {
+                        if (!f(inner_it))
+                            return it;
+                        ++inner_it;
+                    }
                 }
+            }
+
+            return it;
+        }
+
+        template <typename Itr, std::size_t Distance,
+            std::size_t LinesPerChunk, typename ... Ts, typename Body>
+        HPX_FORCEINLINE basic_prefetching_iterator<Itr,
+            static_prefetch_containers<Distance, LinesPerChunk, Ts...> >
+        prefetching_chunks_n(basic_prefetching_iterator<Itr,
+                static_prefetch_containers<Distance, LinesPerChunk, Ts...>
+            > it, std::size_t count, Body && body)
+        {
+            if (count == 0)
                 return it;
+
+            auto const& ctx = it.context();
+
+            ctx.prefetch_prologue(it.index());
+
+            for (/**/; count != 0; (void) --count, ++it)
+            {
+                std::size_t first = it.index();
+                std::size_t last = it.chunk_end();
+
+                if (!body(first, last, Distance))
+                    return it;
             }
-        };
+            return it;
+        }
 
-        template <typename T>
-        struct loop_n <prefetching_iterator<T>>
+        template <typename Itr, typename Containers>
+        struct loop_n <basic_prefetching_iterator<Itr, Containers> >
         {
+            typedef basic_prefetching_iterator<Itr, Containers> iterator_type;
+
             ///////////////////////////////////////////////////////////////////
             // handle sequences of non-futures when using prefetching
             template <typename F>
-            static prefetching_iterator<T> call(prefetching_iterator<T> it, std::size_t count, F && f)
+            static iterator_type call(iterator_type it, std::size_t count,
+                F && f)
             {
-                for (/**/; count != 0; (void) --count, ++it)
-                {
-                    std::vector<std::size_t>::iterator inner_it = it.base;
-                    std::size_t j = it.idx;
-
-                    for(/**/; j < std::min( it.range_size,(it.idx + it.chunk_size) ); ++j)
+                return prefetching_loop_n(it, count,
+                    [&f](Itr inner_it) -> bool
                     {
                         f(inner_it);
-                        ++inner_it;
-                    }
-
-                    if(j < it.range_size - 1  )
-                        for (auto& x: it.M_)
-                            _mm_prefetch(((char*)(&x[j+1])), _MM_HINT_T0);
-                }
-
-                return it;
+                        return true;
+                    });
             }
 
             template <typename CancelToken, typename F>
-            static prefetching_iterator<T> call(prefetching_iterator<T> it, std::size_t count, CancelToken& tok,
-                F && f)
+            static iterator_type call(iterator_type it, std::size_t count,
+                CancelToken& tok, F && f)
             {
-                for (/**/; count != 0; (void) --count, ++it)
-                {
-                    std::vector<std::size_t>::iterator inner_it = it.base;
-                    for(std::size_t j = it.idx;j < std::min( it.range_size,(it.idx + it.chunk_size) ); ++j)
+                return prefetching_loop_n(it, count,
+                    [&f, &tok](Itr inner_it) -> bool
                     {
                         if (tok.was_cancelled())
-                            break;
+                            return false;
                         f(inner_it);
-                        ++inner_it;
-                    }
-                }
-
-                return it;
+                        return true;
+                    });
             }
-
         };
 
+        // Prefetching iterators are processed by loop (as used by the
+        // sequential algorithms) using the same chunked prefetching schedule
+        // as loop_n.
+        template <>
+        struct loop<prefetching_iterator_tag>
+        {
+            template <typename Iter, typename F>
+            static Iter call(Iter it, Iter end, F && f)
+            {
+                return loop_n<Iter>::call(it, end - it, std::forward<F>(f));
+            }
 
+            template <typename Iter, typename CancelToken, typename F>
+            static Iter call(Iter it, Iter end, CancelToken& tok, F && f)
+            {
+                return loop_n<Iter>::call(it, end - it, tok,
+                    std::forward<F>(f));
+            }
+        };
     }
 
     template <typename Iter>
@@ -321,10 +2464,11 @@ namespace hpx { namespace parallel { namespace util
         typedef Iter type;
     };
 
-    template <typename T>
-    struct loop_n_iterator_mapping<detail::prefetching_iterator<T> >
+    template <typename Itr, typename Containers>
+    struct loop_n_iterator_mapping<
+        detail::basic_prefetching_iterator<Itr, Containers> >
     {
-        using type = typename detail::prefetching_iterator<T>::base_iterator;
+        typedef Itr type;
     };
 
     ///////////////////////////////////////////////////////////////////////////
@@ -342,6 +2486,96 @@ namespace hpx { namespace parallel { namespace util
         return detail::loop_n<Iter>::call(it, count, tok, std::forward<F>(f));
     };
 
+    ///////////////////////////////////////////////////////////////////////////
+    template <typename Iter>
+    struct is_prefetching_iterator
+      : std::false_type
+    {};
+
+    template <typename Itr, typename Containers>
+    struct is_prefetching_iterator<
+            detail::basic_prefetching_iterator<Itr, Containers> >
+      : std::true_type
+    {};
+
+    // Call f(first, last) once for each of the count chunks starting at it,
+    // where [first, last) are the positions of the chunk's elements in the
+    // base range. The prefetches for the chunk which is prefetch_distance
+    // chunks ahead are issued before f is invoked, which leaves f free to
+    // run a plain (vectorizable) loop over the whole chunk.
+    template <typename Itr, typename Containers, typename F>
+    HPX_FORCEINLINE detail::basic_prefetching_iterator<Itr, Containers>
+    loop_chunks_n(detail::basic_prefetching_iterator<Itr, Containers> it,
+        std::size_t count, F && f)
+    {
+        if (count == 0)
+            return it;
+
+        auto const& ctx = it.context();
+        return detail::prefetching_chunks_n(it, count,
+            [&ctx, &f](std::size_t first, std::size_t last,
+                std::size_t distance) -> bool
+            {
+                ctx.prefetch_ahead(first, last, distance);
+                f(first, last);
+                return true;
+            });
+    }
+
+#if defined(HPX_HAVE_CXX20_COROUTINES)
+    ///////////////////////////////////////////////////////////////////////////
+    // Call the coroutine f(*it) for each of the count elements starting at
+    // it, keeping up to 'width' of the coroutines in flight and resuming
+    // them round-robin (asynchronous memory access chaining). Every
+    // co_await prefetch_and_switch() of a coroutine overlaps its miss with
+    // the work of the others, which hides the latency of chains of
+    // dependent loads (lists, trees, hash chains). f should take its
+    // arguments by value, the coroutines outlive the iteration step which
+    // created them.
+    template <typename Iter, typename F>
+    Iter loop_interleaved_n(Iter it, std::size_t count, std::size_t width,
+        F && f)
+    {
+        if (width == 0)
+            width = 1;
+        if (count < width)
+            width = count;
+
+        std::vector<prefetch_task> tasks;
+        tasks.reserve(width);
+        for (/**/; tasks.size() != width; (void) --count, ++it)
+            tasks.push_back(f(*it));
+
+        std::size_t active = width;
+        while (active != 0)
+        {
+            for (prefetch_task& task: tasks)
+            {
+                if (!task)
+                    continue;
+
+                task.resume();
+                if (!task.done())
+                    continue;
+
+                task.get();
+                if (count != 0)
+                {
+                    task = f(*it);
+                    --count;
+                    ++it;
+                }
+                else
+                {
+                    task = prefetch_task();
+                    --active;
+                }
+            }
+        }
+        return it;
+    }
+#endif
+
     ///////////////////////////////////////////////////////////////////////////
     namespace detail
     {
@@ -394,7 +2628,7 @@ namespace hpx { namespace parallel { namespace util
     HPX_FORCEINLINE Iter
     loop_with_cleanup(Iter it, Iter last, F && f, Cleanup && cleanup)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_with_cleanup<cat>::call(it, last,
             std::forward<F>(f), std::forward<Cleanup>(cleanup));
     }
@@ -404,7 +2638,7 @@ namespace hpx { namespace parallel { namespace util
     loop_with_cleanup(Iter it, Iter last, FwdIter dest, F && f,
         Cleanup && cleanup)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_with_cleanup<cat>::call(it, last, dest,
             std::forward<F>(f), std::forward<Cleanup>(cleanup));
     }
@@ -500,6 +2734,144 @@ namespace hpx { namespace parallel { namespace util
                 }
             }
         };
+
+        // The elements of the base range are processed using the prefetching
+        // schedule. If an exception is thrown, the cleanup function is called
+        // for the base (or destination) iterators of all elements processed
+        // so far.
+        template <>
+        struct loop_with_cleanup_n<prefetching_iterator_tag>
+        {
+            ///////////////////////////////////////////////////////////////////
+            template <typename Iter, typename F, typename Cleanup>
+            static Iter call(Iter it, std::size_t count, F && f,
+                Cleanup && cleanup)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+
+                base_iterator base = it.base();
+                base_iterator curr = base;
+                try {
+                    return prefetching_loop_n(it, count,
+                        [&f, &curr](base_iterator inner_it) -> bool
+                        {
+                            curr = inner_it;
+                            f(inner_it);
+                            return true;
+                        });
+                }
+                catch (...) {
+                    for (/**/; base != curr; ++base)
+                        cleanup(base);
+                    throw;
+                }
+            }
+
+            template <typename Iter, typename FwdIter, typename F,
+                typename Cleanup>
+            static FwdIter call(Iter it, std::size_t count, FwdIter dest,
+                F && f, Cleanup && cleanup)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+
+                FwdIter base = dest;
+                try {
+                    prefetching_loop_n(it, count,
+                        [&f, &dest](base_iterator inner_it) -> bool
+                        {
+                            f(inner_it, dest);
+                            ++dest;
+                            return true;
+                        });
+                    return dest;
+                }
+                catch (...) {
+                    for (/**/; base != dest; ++base)
+                        cleanup(base);
+                    throw;
+                }
+            }
+
+            ///////////////////////////////////////////////////////////////////
+            template <typename Iter, typename CancelToken, typename F,
+                typename Cleanup>
+            static Iter call_with_token(Iter it, std::size_t count,
+                CancelToken& tok, F && f, Cleanup && cleanup)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+
+                base_iterator base = it.base();
+                base_iterator curr = base;
+                try {
+                    return prefetching_loop_n(it, count,
+                        [&f, &tok, &curr](base_iterator inner_it) -> bool
+                        {
+                            if (tok.was_cancelled())
+                                return false;
+                            curr = inner_it;
+                            f(inner_it);
+                            return true;
+                        });
+                }
+                catch (...) {
+                    tok.cancel();
+                    for (/**/; base != curr; ++base)
+                        cleanup(base);
+                    throw;
+                }
+            }
+
+            template <typename Iter, typename FwdIter, typename CancelToken,
+                typename F, typename Cleanup>
+            static FwdIter call_with_token(Iter it, std::size_t count,
+                FwdIter dest, CancelToken& tok, F && f, Cleanup && cleanup)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+
+                FwdIter base = dest;
+                try {
+                    prefetching_loop_n(it, count,
+                        [&f, &tok, &dest](base_iterator inner_it) -> bool
+                        {
+                            if (tok.was_cancelled())
+                                return false;
+                            f(inner_it, dest);
+                            ++dest;
+                            return true;
+                        });
+                    return dest;
+                }
+                catch (...) {
+                    tok.cancel();
+                    for (/**/; base != dest; ++base)
+                        cleanup(base);
+                    throw;
+                }
+            }
+        };
+
+        template <>
+        struct loop_with_cleanup<prefetching_iterator_tag>
+        {
+            ///////////////////////////////////////////////////////////////////
+            template <typename Iter, typename F, typename Cleanup>
+            static Iter call(Iter it, Iter last, F && f, Cleanup && cleanup)
+            {
+                return loop_with_cleanup_n<prefetching_iterator_tag>::call(
+                    it, last - it, std::forward<F>(f),
+                    std::forward<Cleanup>(cleanup));
+            }
+
+            template <typename Iter, typename FwdIter, typename F,
+                typename Cleanup>
+            static FwdIter call(Iter it, Iter last, FwdIter dest, F && f,
+                Cleanup && cleanup)
+            {
+                return loop_with_cleanup_n<prefetching_iterator_tag>::call(
+                    it, last - it, dest, std::forward<F>(f),
+                    std::forward<Cleanup>(cleanup));
+            }
+        };
     }
 
     ///////////////////////////////////////////////////////////////////////////
@@ -507,7 +2879,7 @@ namespace hpx { namespace parallel { namespace util
     HPX_FORCEINLINE Iter
     loop_with_cleanup_n(Iter it, std::size_t count, F && f, Cleanup && cleanup)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_with_cleanup_n<cat>::call(it, count,
             std::forward<F>(f), std::forward<Cleanup>(cleanup));
     }
@@ -517,7 +2889,7 @@ namespace hpx { namespace parallel { namespace util
     loop_with_cleanup_n(Iter it, std::size_t count, FwdIter dest, F && f,
         Cleanup && cleanup)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_with_cleanup_n<cat>::call(it, count, dest,
             std::forward<F>(f), std::forward<Cleanup>(cleanup));
     }
@@ -527,7 +2899,7 @@ namespace hpx { namespace parallel { namespace util
     loop_with_cleanup_n_with_token(Iter it, std::size_t count,
         CancelToken& tok, F && f, Cleanup && cleanup)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_with_cleanup_n<cat>::call_with_token(it, count,
             tok, std::forward<F>(f), std::forward<Cleanup>(cleanup));
     };
@@ -538,7 +2910,7 @@ namespace hpx { namespace parallel { namespace util
     loop_with_cleanup_n_with_token(Iter it, std::size_t count, FwdIter dest,
         CancelToken& tok, F && f, Cleanup && cleanup)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_with_cleanup_n<cat>::call_with_token(it, count,
             dest, tok, std::forward<F>(f), std::forward<Cleanup>(cleanup));
     };
@@ -577,6 +2949,55 @@ namespace hpx { namespace parallel { namespace util
                 return it;
             }
         };
+
+        // base_idx is given in iterator units, i.e. it is the number of
+        // chunks between it and the first iterator the algorithm was
+        // invoked with. The index passed to f is the position of the element
+        // in the base range relative to the first element of that iterator.
+        template <>
+        struct loop_idx_n<prefetching_iterator_tag>
+        {
+            template <typename Iter>
+            static std::size_t element_index(std::size_t base_idx, Iter it)
+            {
+                return it.index() -
+                    (it - typename Iter::difference_type(base_idx)).index();
+            }
+
+            ///////////////////////////////////////////////////////////////////
+            template <typename Iter, typename F>
+            static Iter
+            call(std::size_t base_idx, Iter it, std::size_t count, F && f)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+
+                std::size_t idx = element_index(base_idx, it);
+                return prefetching_loop_n(it, count,
+                    [&f, &idx](base_iterator inner_it) -> bool
+                    {
+                        f(*inner_it, idx++);
+                        return true;
+                    });
+            }
+
+            template <typename Iter, typename CancelToken, typename F>
+            static Iter
+            call(std::size_t base_idx, Iter it, std::size_t count,
+                CancelToken& tok, F && f)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+
+                std::size_t idx = element_index(base_idx, it);
+                return prefetching_loop_n(it, count,
+                    [&f, &tok, &idx](base_iterator inner_it) -> bool
+                    {
+                        if (tok.was_cancelled(idx))
+                            return false;
+                        f(*inner_it, idx++);
+                        return true;
+                    });
+            }
+        };
     }
 
     ///////////////////////////////////////////////////////////////////////////
@@ -584,7 +3005,7 @@ namespace hpx { namespace parallel { namespace util
     HPX_FORCEINLINE Iter
     loop_idx_n(std::size_t base_idx, Iter it, std::size_t count, F && f)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_idx_n<cat>::call(base_idx, it, count,
             std::forward<F>(f));
     }
@@ -594,7 +3015,7 @@ namespace hpx { namespace parallel { namespace util
     loop_idx_n(std::size_t base_idx, Iter it, std::size_t count,
         CancelToken& tok, F && f)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::loop_idx_n<cat>::call(base_idx, it, count, tok,
             std::forward<F>(f));
     };
@@ -615,6 +3036,23 @@ namespace hpx { namespace parallel { namespace util
                 return init;
             }
         };
+
+        template <>
+        struct accumulate_n<prefetching_iterator_tag>
+        {
+            template <typename Iter, typename T, typename Pred>
+            static T call(Iter it, std::size_t count, T init, Pred && f)
+            {
+                typedef typename Iter::base_iterator base_iterator;
+                prefetching_loop_n(it, count,
+                    [&f, &init](base_iterator inner_it) -> bool
+                    {
+                        init = f(init, *inner_it);
+                        return true;
+                    });
+                return init;
+            }
+        };
     }
 
     ///////////////////////////////////////////////////////////////////////////
@@ -622,7 +3060,7 @@ namespace hpx { namespace parallel { namespace util
     HPX_FORCEINLINE T
     accumulate_n(Iter it, std::size_t count, T init, Pred && f)
     {
-        typedef typename std::iterator_traits<Iter>::iterator_category cat;
+        typedef typename detail::loop_iterator_category<Iter>::type cat;
         return detail::accumulate_n<cat>::call(it, count, std::move(init),
             std::forward<Pred>(f));
     }
@@ -0,0 +1,213 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_PREFETCH_BUDGET_HPP)
+#define HPX_PARALLEL_UTIL_PREFETCH_BUDGET_HPP
+
+#include <hpx/config.hpp>
+#include <hpx/parallel/util/cache_topology.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace hpx { namespace parallel { namespace util
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // The capacity for data in flight (a share of the last level cache,
+    // which holds the chunks prefetched ahead by the workers of all cores)
+    // split between all loops which run at the same time. Each active loop
+    // gets a share of the capacity proportional to its weight, the rate at
+    // which it consumes the lines of its containers: by Little's law this
+    // is what the look-ahead of a loop has to cover. The distance of a loop
+    // is limited such that the chunks its workers prefetch ahead fit into
+    // its share, the distances shrink as more loops become active. The
+    // per core limit is applied by each context on its own (see
+    // prefetcher_context::limit_footprint).
+    class prefetch_budget
+    {
+    public:
+        explicit prefetch_budget(std::size_t capacity)
+          : capacity_(capacity == 0 ? 1 : capacity), active_(0), weights_(0)
+        {}
+
+        prefetch_budget(prefetch_budget const&) = delete;
+        prefetch_budget& operator=(prefetch_budget const&) = delete;
+
+        std::size_t capacity() const { return capacity_; }
+
+        // the number of loops currently running
+        std::size_t active() const
+        {
+            return active_.load(std::memory_order_relaxed);
+        }
+
+        void activate(std::size_t weight)
+        {
+            active_.fetch_add(1, std::memory_order_relaxed);
+            weights_.fetch_add(weight, std::memory_order_relaxed);
+        }
+
+        void deactivate(std::size_t weight)
+        {
+            weights_.fetch_sub(weight, std::memory_order_relaxed);
+            active_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // the number of bytes in flight granted to an active loop of the
+        // given weight
+        std::size_t share(std::size_t weight) const
+        {
+            std::size_t weights = weights_.load(std::memory_order_relaxed);
+            if (weights < weight)
+                weights = weight;
+            return weights == 0 ? capacity_ :
+                std::size_t(double(capacity_) * weight / weights);
+        }
+
+        // the number of bytes in flight an inactive loop of the given
+        // weight would be granted once it becomes active
+        std::size_t join_share(std::size_t weight) const
+        {
+            std::size_t const weights =
+                weights_.load(std::memory_order_relaxed) + weight;
+            return weights == 0 ? capacity_ :
+                std::size_t(double(capacity_) * weight / weights);
+        }
+
+    private:
+        std::size_t capacity_;
+        std::atomic<std::size_t> active_;
+        std::atomic<std::size_t> weights_;
+    };
+
+    // The budget shared by all loops of the process.
+    inline prefetch_budget& get_prefetch_budget()
+    {
+        static prefetch_budget budget(get_cache_topology().llc_size / 2);
+        return budget;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // The registration of a prefetcher_context with a prefetch_budget. The
+    // context counts as active while at least one worker runs a loop over
+    // it. The weight of the context is measured by its workers (bytes of
+    // the containers retired per timestamp tick, averaged over the loops),
+    // a change takes effect the next time the context becomes active. The
+    // share of the context is split evenly between its active workers.
+    class prefetch_budget_share
+    {
+    public:
+        // the weight of a context which has not been measured yet, a
+        // weight of weight_unit corresponds to one byte per tick
+        static std::size_t const weight_unit = 256;
+
+        // the weight can be given if the rate of the loops is known
+        explicit prefetch_budget_share(
+                prefetch_budget& budget = get_prefetch_budget(),
+                std::size_t weight = weight_unit)
+          : budget_(budget), workers_(0), weight_(weight == 0 ? 1 : weight),
+            active_weight_(0)
+        {}
+
+        ~prefetch_budget_share()
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            if (workers_.load(std::memory_order_relaxed) != 0)
+                budget_.deactivate(active_weight_.load());
+        }
+
+        prefetch_budget_share(prefetch_budget_share const&) = delete;
+        prefetch_budget_share& operator=(prefetch_budget_share const&) = delete;
+
+        prefetch_budget& budget() const { return budget_; }
+
+        std::size_t weight() const
+        {
+            return weight_.load(std::memory_order_relaxed);
+        }
+
+        bool active() const
+        {
+            return active_weight_.load(std::memory_order_relaxed) != 0;
+        }
+
+        // the number of workers running a loop over the context
+        std::size_t workers() const
+        {
+            return workers_.load(std::memory_order_relaxed);
+        }
+
+        // called by each worker when it starts or finishes a loop over the
+        // context, the latter with the bytes the worker retired and the
+        // time it took
+        void enter()
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            if (workers_.fetch_add(1, std::memory_order_relaxed) == 0)
+            {
+                std::size_t const w = weight();
+                active_weight_.store(w, std::memory_order_relaxed);
+                budget_.activate(w);
+            }
+        }
+
+        void leave(std::size_t bytes, std::uint64_t ticks)
+        {
+            if (ticks != 0 && bytes != 0)
+            {
+                std::size_t sample =
+                    std::size_t(double(bytes) * weight_unit / double(ticks));
+                if (sample == 0)
+                    sample = 1;
+                // the workers of the context leave concurrently
+                std::size_t w = weight();
+                while (!weight_.compare_exchange_weak(w,
+                    (3 * w + sample + 3) / 4, std::memory_order_relaxed))
+                {}
+            }
+
+            std::lock_guard<std::mutex> l(mtx_);
+            if (workers_.fetch_sub(1, std::memory_order_relaxed) == 1)
+            {
+                budget_.deactivate(active_weight_.load());
+                active_weight_.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        // the largest distance for which the chunks prefetched ahead by
+        // each worker fit into the share of the budget of this context, for
+        // an inactive context the share it would get when becoming active
+        std::size_t max_distance(std::size_t chunk_bytes) const
+        {
+            if (chunk_bytes == 0)
+                return std::size_t(-1);
+
+            std::size_t const w =
+                active_weight_.load(std::memory_order_relaxed);
+            std::size_t const share = w != 0 ?
+                budget_.share(w) : budget_.join_share(weight());
+
+            std::size_t workers = this->workers();
+            if (workers == 0)
+                workers = 1;
+
+            std::size_t const d = share / (workers * chunk_bytes);
+            return d == 0 ? 1 : d;
+        }
+
+    private:
+        prefetch_budget& budget_;
+        std::mutex mtx_;
+        // changed only while holding mtx_
+        std::atomic<std::size_t> workers_;
+        std::atomic<std::size_t> weight_;
+        // the weight the context was activated with, zero if inactive
+        std::atomic<std::size_t> active_weight_;
+    };
+}}}
+
+#endif
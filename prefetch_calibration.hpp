@@ -0,0 +1,140 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_PREFETCH_CALIBRATION_HPP)
+#define HPX_PARALLEL_UTIL_PREFETCH_CALIBRATION_HPP
+
+#include <hpx/config.hpp>
+#include <hpx/util/hardware/timestamp.hpp>
+#include <hpx/parallel/util/cache_topology.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace hpx { namespace parallel { namespace util { namespace detail
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // A prefetcher_context created with a prefetcher_distance_factor of zero
+    // derives its prefetch distance from the latency of the memory and from
+    // the cost of the kernel. The first calibration_skip_chunks chunks of the
+    // first invocation warm up the caches, the kernel is timed over the
+    // following calibration_chunks chunks, which are prefetched using
+    // max_calibrated_distance.
+    std::size_t const calibration_skip_chunks = 2;
+    std::size_t const calibration_chunks = 8;
+    std::size_t const max_calibrated_distance = 32;
+
+    // The buffer used to measure the memory latency has to be well beyond
+    // the size of the last level cache, otherwise part of the loads hit.
+    inline std::size_t memory_latency_buffer_size()
+    {
+        std::size_t const min_size = 64ul * 1024 * 1024;
+        std::size_t const size = 4 * get_cache_topology().llc_size;
+        return size < min_size ? min_size : size;
+    }
+
+    // Measure the latency of loads missing all caches (in timestamp counter
+    // ticks) by chasing pointers through a buffer of buffer_size bytes, which
+    // is visited one cache line at a time in random order.
+    inline std::uint64_t
+    measure_memory_latency(
+        std::size_t buffer_size = memory_latency_buffer_size(),
+        std::size_t loads = 100000,
+        std::size_t line_size = get_cache_topology().line_size)
+    {
+        std::size_t const line = line_size / sizeof(std::size_t);
+        std::size_t const lines = buffer_size / line_size;
+
+        std::vector<std::size_t> order(lines);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::shuffle(order.begin() + 1, order.end(), std::minstd_rand(42));
+
+        // every visited cache line holds the position of the next one
+        std::vector<std::size_t> next(lines * line);
+        for (std::size_t i = 0; i != lines; ++i)
+            next[order[i] * line] = order[(i + 1) % lines] * line;
+
+        std::size_t p = 0;
+        std::uint64_t const start = hpx::util::hardware::timestamp();
+        for (std::size_t i = 0; i != loads; ++i)
+            p = next[p];
+        std::uint64_t const stop = hpx::util::hardware::timestamp();
+
+        // make sure the chase is not optimized away
+        std::size_t volatile sink = p;
+        (void)sink;
+
+        std::uint64_t const latency = (stop - start) / loads;
+        return latency == 0 ? 1 : latency;
+    }
+
+    // The latency assumed as long as it has not been measured, in
+    // timestamp counter ticks.
+    std::uint64_t const default_memory_latency = 300;
+
+    inline std::atomic<std::uint64_t>& measured_memory_latency()
+    {
+        static std::atomic<std::uint64_t> latency(0);
+        return latency;
+    }
+
+    // The memory latency as measured by calibrate_prefetcher. This is called
+    // from within the timed sample of the loops, it never measures itself.
+    inline std::uint64_t memory_latency()
+    {
+        std::uint64_t const latency =
+            measured_memory_latency().load(std::memory_order_acquire);
+        return latency != 0 ? latency : default_memory_latency;
+    }
+
+    // The number of chunks the prefetches have to run ahead to hide the
+    // memory latency, given that processing the sample of 'elements'
+    // elements took 'ticks' timestamp counter ticks.
+    inline std::size_t
+    calibrated_prefetch_distance(std::uint64_t ticks, std::size_t elements,
+        std::size_t chunk_size)
+    {
+        if (elements == 0)
+            return 1;
+
+        double const chunk_cost =
+            double(ticks) * double(chunk_size) / double(elements);
+        if (chunk_cost < 1.0)
+            return max_calibrated_distance;
+
+        std::size_t distance = std::size_t(
+            double(memory_latency()) / chunk_cost) + 1;
+        if (distance > max_calibrated_distance)
+            distance = max_calibrated_distance;
+        return distance;
+    }
+}
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Measure the memory latency used to calibrate the prefetch distance of
+    // the contexts created with a prefetcher_distance_factor of zero. The
+    // measurement takes a while (and allocates a large buffer), it is run
+    // once per process, either explicitly during the initialization of the
+    // application or by the constructor of the first calibrating context,
+    // but never inside of a loop. Returns the latency in timestamp counter
+    // ticks.
+    inline std::uint64_t calibrate_prefetcher()
+    {
+        static std::once_flag measured;
+        std::call_once(measured, []()
+        {
+            detail::measured_memory_latency().store(
+                detail::measure_memory_latency(), std::memory_order_release);
+        });
+        return detail::memory_latency();
+    }
+}}}
+
+#endif
@@ -0,0 +1,228 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_PREFETCH_COROUTINE_HPP)
+#define HPX_PARALLEL_UTIL_PREFETCH_COROUTINE_HPP
+
+#include <hpx/config.hpp>
+
+// The interleaved loops (see loop_interleaved_n) require support for C++20
+// coroutines.
+#if !defined(HPX_HAVE_CXX20_COROUTINES) && \
+    defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define HPX_HAVE_CXX20_COROUTINES
+#endif
+
+#if defined(HPX_HAVE_CXX20_COROUTINES)
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <xmmintrin.h>
+
+namespace hpx { namespace parallel { namespace util
+{
+    namespace detail
+    {
+        ///////////////////////////////////////////////////////////////////////
+        // The coroutines of an interleaved loop are all created from the same
+        // function and therefore have frames of the same size. Each thread
+        // keeps a few of the released frames for reuse, which avoids going
+        // to the heap once per element.
+        class coroutine_frame_cache
+        {
+            static std::size_t const max_cached_frames = 64;
+
+        public:
+            static void* allocate(std::size_t size)
+            {
+                coroutine_frame_cache& c = get();
+                if (size == c.size_ && !c.frames_.empty())
+                {
+                    void* p = c.frames_.back();
+                    c.frames_.pop_back();
+                    return p;
+                }
+                return ::operator new(size);
+            }
+
+            static void deallocate(void* p, std::size_t size) noexcept
+            {
+                coroutine_frame_cache& c = get();
+                if (c.size_ != size && c.frames_.empty())
+                    c.size_ = size;
+
+                if (size == c.size_ && c.frames_.size() < max_cached_frames)
+                {
+                    c.frames_.push_back(p);
+                    return;
+                }
+                ::operator delete(p);
+            }
+
+            ~coroutine_frame_cache()
+            {
+                for (void* p: frames_)
+                    ::operator delete(p);
+            }
+
+        private:
+            coroutine_frame_cache()
+              : size_(0)
+            {
+                frames_.reserve(max_cached_frames);
+            }
+
+            static coroutine_frame_cache& get()
+            {
+                static thread_local coroutine_frame_cache cache;
+                return cache;
+            }
+
+            std::size_t size_;
+            std::vector<void*> frames_;
+        };
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // The return type of the coroutines run by loop_interleaved_n. The
+    // coroutine is started suspended, it is resumed by the loop driver until
+    // it completes. Exceptions thrown by the coroutine are rethrown by the
+    // driver.
+    class prefetch_task
+    {
+    public:
+        struct promise_type
+        {
+            prefetch_task get_return_object() noexcept
+            {
+                return prefetch_task(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+            std::suspend_always final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void return_void() const noexcept {}
+
+            void unhandled_exception() noexcept
+            {
+                exception_ = std::current_exception();
+            }
+
+            static void* operator new(std::size_t size)
+            {
+                return detail::coroutine_frame_cache::allocate(size);
+            }
+
+            static void operator delete(void* p, std::size_t size) noexcept
+            {
+                detail::coroutine_frame_cache::deallocate(p, size);
+            }
+
+            std::exception_ptr exception_;
+        };
+
+        typedef std::coroutine_handle<promise_type> handle_type;
+
+        prefetch_task() noexcept
+          : handle_(nullptr)
+        {}
+
+        prefetch_task(prefetch_task && rhs) noexcept
+          : handle_(rhs.handle_)
+        {
+            rhs.handle_ = nullptr;
+        }
+
+        prefetch_task& operator=(prefetch_task && rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = rhs.handle_;
+                rhs.handle_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~prefetch_task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(handle_);
+        }
+
+        bool done() const noexcept
+        {
+            return handle_.done();
+        }
+
+        void resume() const
+        {
+            handle_.resume();
+        }
+
+        // rethrow the exception which terminated the coroutine, if any
+        void get() const
+        {
+            if (handle_.promise().exception_)
+                std::rethrow_exception(handle_.promise().exception_);
+        }
+
+    private:
+        explicit prefetch_task(handle_type h) noexcept
+          : handle_(h)
+        {}
+
+        handle_type handle_;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Issue a prefetch for the given address and let the loop driver switch
+    // to the next coroutine, the coroutine is resumed once all others have
+    // had their turn, by which time the prefetched line should have
+    // arrived, e.g. 'co_await prefetch_and_switch(node->next);'.
+    struct prefetch_awaitable
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<>) const noexcept
+        {
+            _mm_prefetch(static_cast<char const*>(address), _MM_HINT_T0);
+        }
+
+        void await_resume() const noexcept {}
+
+        void const* address;
+    };
+
+    template <typename T>
+    HPX_FORCEINLINE prefetch_awaitable prefetch_and_switch(T const* p)
+    {
+        return prefetch_awaitable{ p };
+    }
+}}}
+
+#endif
+#endif
@@ -0,0 +1,351 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_PREFETCH_HELPER_HPP)
+#define HPX_PARALLEL_UTIL_PREFETCH_HELPER_HPP
+
+#include <hpx/config.hpp>
+#include <hpx/hpx_fwd.hpp>
+#include <hpx/exception.hpp>
+#include <hpx/runtime/threads/threadmanager.hpp>
+#include <hpx/runtime/threads/topology.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <xmmintrin.h>
+
+namespace hpx { namespace parallel { namespace util { namespace detail
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // The prefetches of a worker running in helper thread mode are issued by
+    // a helper thread which runs on the SMT sibling of the worker's core
+    // (and therefore shares its caches). The worker publishes the first
+    // element of the chunk it is processing through the progress counter of
+    // a prefetch_job, the helper prefetches the chunks following it, but
+    // never more than run_ahead elements ahead of the worker.
+    struct prefetch_job
+    {
+        typedef void (*prefetch_function)(void const* ctx,
+            std::size_t first_idx, std::size_t last_idx);
+
+        prefetch_job(prefetch_function f, void const* ctx, std::size_t first,
+                std::size_t last, std::size_t chunk, std::size_t run_ahead)
+          : prefetch(f), ctx(ctx), last(last), chunk_size(chunk),
+            run_ahead(run_ahead), progress(first)
+        {}
+
+        prefetch_function prefetch;
+        void const* ctx;
+        // the end of the elements processed by the worker
+        std::size_t last;
+        std::size_t chunk_size;
+        std::size_t run_ahead;
+        // the first element of the chunk the worker is processing, last
+        // once the worker is done
+        std::atomic<std::size_t> progress;
+    };
+
+    // Prefetch the elements [first_idx, last_idx) of the containers of a
+    // prefetcher_context.
+    template <typename Context>
+    void prefetch_context_range(void const* ctx, std::size_t first_idx,
+        std::size_t last_idx)
+    {
+        static_cast<Context const*>(ctx)->prefetch(first_idx, last_idx);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // The PU the helper thread of the given worker thread is bound to: a PU
+    // of the worker's core other than the worker's own one. PUs used by any
+    // HPX worker thread are skipped, a helper there would compete with that
+    // worker for the core instead of feeding its own. Returns -1 if there
+    // is no such PU.
+    inline std::ptrdiff_t smt_sibling_pu(std::size_t worker)
+    {
+        threads::topology const& topo = threads::get_topology();
+        threads::mask_type const candidates =
+            topo.get_core_affinity_mask(worker, false) &
+            ~topo.get_thread_affinity_mask(worker, false) &
+            ~threads::get_thread_manager().get_used_processing_units();
+
+        std::size_t const size = threads::mask_size(candidates);
+        for (std::size_t pu = 0; pu != size; ++pu)
+        {
+            if (threads::test(candidates, pu))
+                return std::ptrdiff_t(pu);
+        }
+        return -1;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // A thread bound to one PU which runs the prefetch jobs posted by the
+    // worker it is paired with. The worker waits in finish() until the
+    // helper has let go of the job, so jobs can live on the worker's stack.
+    //
+    // Neither side spins for long: the helper parks on a condition variable
+    // when it is run_ahead elements ahead of the worker (the worker wakes it
+    // when publishing its progress, but only if it is parked), the worker
+    // spins for a short while in finish() and blocks afterwards. The helper
+    // lets go of the job at the latest after the prefetches for one chunk,
+    // so finish() blocks the worker's core only briefly.
+    class prefetch_helper_thread
+    {
+    public:
+        // the number of iterations either side spins before it blocks
+        static std::size_t const spin_count = 1024;
+
+        // start the helper thread and wait until it has tried to bind
+        // itself to the given PU
+        explicit prefetch_helper_thread(std::size_t pu)
+          : job_(nullptr), parked_(false), stop_(false), started_(false),
+            bound_(false), thread_(&prefetch_helper_thread::run, this, pu)
+        {
+            std::unique_lock<std::mutex> l(mtx_);
+            released_.wait(l, [this]() { return started_; });
+        }
+
+        ~prefetch_helper_thread()
+        {
+            {
+                std::lock_guard<std::mutex> l(mtx_);
+                stop_ = true;
+            }
+            cond_.notify_one();
+            thread_.join();
+        }
+
+        prefetch_helper_thread(prefetch_helper_thread const&) = delete;
+        prefetch_helper_thread& operator=(
+            prefetch_helper_thread const&) = delete;
+
+        // whether the helper runs on the PU it was created for, a helper
+        // which couldn't be bound must not be used
+        bool bound() const
+        {
+            return bound_;
+        }
+
+        void post(prefetch_job& job)
+        {
+            {
+                std::lock_guard<std::mutex> l(mtx_);
+                job_.store(&job, std::memory_order_release);
+            }
+            cond_.notify_one();
+        }
+
+        // publish the first element of the chunk the worker is processing
+        HPX_FORCEINLINE void progress(prefetch_job& job, std::size_t first)
+        {
+            // pairs with the store to parked_ in wait_for_progress, either
+            // the helper sees the new progress or the worker sees it parked
+            job.progress.store(first, std::memory_order_seq_cst);
+            if (parked_.load(std::memory_order_seq_cst))
+            {
+                { std::lock_guard<std::mutex> l(mtx_); }
+                cond_.notify_one();
+            }
+        }
+
+        // mark the job as done and wait for the helper to release it
+        void finish(prefetch_job& job)
+        {
+            progress(job, job.last);
+
+            for (std::size_t k = 0; k != spin_count; ++k)
+            {
+                if (job_.load(std::memory_order_acquire) == nullptr)
+                    return;
+                _mm_pause();
+            }
+
+            std::unique_lock<std::mutex> l(mtx_);
+            released_.wait(l, [this]()
+            {
+                return job_.load(std::memory_order_acquire) == nullptr;
+            });
+        }
+
+    private:
+        static bool bind(std::size_t pu)
+        {
+            threads::mask_type mask = threads::mask_type();
+            threads::resize(mask, threads::hardware_concurrency());
+            threads::set(mask, pu);
+
+            error_code ec(lightweight);
+            threads::get_topology().set_thread_affinity_mask(mask, ec);
+            return !ec;
+        }
+
+        void run(std::size_t pu)
+        {
+            bool const bound = bind(pu);
+
+            std::unique_lock<std::mutex> l(mtx_);
+            bound_ = bound;
+            started_ = true;
+            released_.notify_one();
+            if (!bound)
+                return;
+
+            for (;;)
+            {
+                cond_.wait(l, [this]()
+                {
+                    return stop_ ||
+                        job_.load(std::memory_order_acquire) != nullptr;
+                });
+                if (stop_)
+                    break;
+
+                l.unlock();
+
+                run_ahead(*job_.load(std::memory_order_acquire));
+
+                l.lock();
+                job_.store(nullptr, std::memory_order_release);
+                released_.notify_one();
+            }
+        }
+
+        // wait until the worker has moved past the given element
+        void wait_for_progress(prefetch_job& job, std::size_t progress)
+        {
+            for (std::size_t k = 0; k != spin_count; ++k)
+            {
+                if (job.progress.load(std::memory_order_acquire) != progress)
+                    return;
+                _mm_pause();
+            }
+
+            std::unique_lock<std::mutex> l(mtx_);
+            parked_.store(true, std::memory_order_seq_cst);
+            cond_.wait(l, [&]()
+            {
+                return job.progress.load(std::memory_order_seq_cst) !=
+                    progress;
+            });
+            parked_.store(false, std::memory_order_relaxed);
+        }
+
+        // prefetch chunk by chunk, staying ahead of the worker but at most
+        // job.run_ahead elements
+        void run_ahead(prefetch_job& job)
+        {
+            std::size_t next = 0;
+            for (;;)
+            {
+                std::size_t const progress =
+                    job.progress.load(std::memory_order_acquire);
+                if (progress >= job.last)
+                    break;
+
+                // the chunk the worker is in has been prefetched already
+                if (next < progress + job.chunk_size)
+                    next = progress + job.chunk_size;
+
+                if (next >= job.last ||
+                    next >= progress + job.chunk_size + job.run_ahead)
+                {
+                    wait_for_progress(job, progress);
+                    continue;
+                }
+
+                std::size_t last = next + job.chunk_size;
+                if (last > job.last)
+                    last = job.last;
+
+                job.prefetch(job.ctx, next, last);
+                next = last;
+            }
+        }
+
+        std::atomic<prefetch_job*> job_;
+        std::atomic<bool> parked_;
+        bool stop_;
+        bool started_;
+        bool bound_;
+        std::mutex mtx_;
+        std::condition_variable cond_;
+        std::condition_variable released_;
+        std::thread thread_;
+    };
+
+    // The helper thread paired with the calling worker thread. The helpers
+    // are kept per HPX worker thread (each slot is only used by its own
+    // worker) and are created on first use. Returns nullptr (the worker
+    // issues its prefetches itself) if the caller isn't an HPX worker
+    // thread, if its core has no PU which is free for a helper, or if the
+    // helper couldn't be bound to it.
+    inline prefetch_helper_thread* get_prefetch_helper()
+    {
+        struct helper_slot
+        {
+            helper_slot() : created(false) {}
+
+            bool created;
+            std::unique_ptr<prefetch_helper_thread> helper;
+        };
+        static std::vector<helper_slot> helpers(hpx::get_os_thread_count());
+
+        std::size_t const worker = hpx::get_worker_thread_num();
+        if (worker >= helpers.size())
+            return nullptr;
+
+        helper_slot& slot = helpers[worker];
+        if (!slot.created)
+        {
+            slot.created = true;
+
+            std::ptrdiff_t const pu = smt_sibling_pu(worker);
+            if (pu >= 0)
+            {
+                slot.helper.reset(new prefetch_helper_thread(std::size_t(pu)));
+                if (!slot.helper->bound())
+                    slot.helper.reset();
+            }
+        }
+        return slot.helper.get();
+    }
+
+    // Posts a job to a helper thread and finishes it when leaving the scope,
+    // also if the loop body throws.
+    class prefetch_helper_scope
+    {
+    public:
+        prefetch_helper_scope(prefetch_helper_thread& helper,
+                prefetch_job& job)
+          : helper_(helper), job_(job)
+        {
+            helper_.post(job_);
+        }
+
+        HPX_FORCEINLINE void progress(std::size_t first)
+        {
+            helper_.progress(job_, first);
+        }
+
+        ~prefetch_helper_scope()
+        {
+            helper_.finish(job_);
+        }
+
+        prefetch_helper_scope(prefetch_helper_scope const&) = delete;
+        prefetch_helper_scope& operator=(prefetch_helper_scope const&) = delete;
+
+    private:
+        prefetch_helper_thread& helper_;
+        prefetch_job& job_;
+    };
+}}}}
+
+#endif
@@ -0,0 +1,179 @@
+//  Copyright (c) 2016 Zahra Khatami
+//
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#if !defined(HPX_PARALLEL_UTIL_PREFETCH_SCHEDULE_HPP)
+#define HPX_PARALLEL_UTIL_PREFETCH_SCHEDULE_HPP
+
+#include <hpx/config.hpp>
+#include <hpx/hpx_fwd.hpp>
+#include <hpx/parallel/util/cache_topology.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace hpx { namespace parallel { namespace util
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // The cache lines accessed by each chunk of a prefetcher_context, as
+    // recorded during the first pass of a loop which is run repeatedly over
+    // the same access pattern (inspector-executor). Accesses are recorded
+    // by wrapping them into record_access() inside of the loop body. Every
+    // following pass replays the recorded lines of the chunk which is the
+    // prefetch distance ahead, in addition to the prefetches of the
+    // containers of the context.
+    //
+    // A chunk is recorded by the worker processing it, all chunks are
+    // recorded during the first pass. Call invalidate() (between passes)
+    // whenever the access pattern changes, e.g. after rebuilding a
+    // neighbor list, the next pass records the schedule again.
+    class prefetch_schedule
+    {
+        struct chunk_record
+        {
+            chunk_record() : recorded(false) {}
+
+            std::vector<std::uintptr_t> lines;
+            std::atomic<bool> recorded;
+        };
+
+    public:
+        prefetch_schedule()
+          : size_(0), line_size_(get_cache_topology().line_size)
+        {}
+
+        prefetch_schedule(prefetch_schedule const&) = delete;
+        prefetch_schedule& operator=(prefetch_schedule const&) = delete;
+
+        // make room for the given number of chunks, keeps the recorded
+        // lines if the number of chunks didn't change
+        void resize(std::size_t chunks)
+        {
+            if (chunks == size_)
+                return;
+
+            chunks_.reset(chunks == 0 ? nullptr : new chunk_record[chunks]);
+            size_ = chunks;
+        }
+
+        // forget all recorded lines
+        void invalidate()
+        {
+            for (std::size_t i = 0; i != size_; ++i)
+            {
+                chunks_[i].lines.clear();
+                chunks_[i].recorded.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        std::size_t size() const { return size_; }
+
+        bool recorded(std::size_t chunk) const
+        {
+            return chunk < size_ &&
+                chunks_[chunk].recorded.load(std::memory_order_acquire);
+        }
+
+        // the number of lines recorded for the given chunk
+        std::size_t lines(std::size_t chunk) const
+        {
+            return recorded(chunk) ? chunks_[chunk].lines.size() : 0;
+        }
+
+        // call prefetch with the address of each of the lines recorded for
+        // the given chunk
+        template <typename F>
+        void replay(std::size_t chunk, F && prefetch) const
+        {
+            if (!recorded(chunk))
+                return;
+
+            for (std::uintptr_t line: chunks_[chunk].lines)
+                prefetch(reinterpret_cast<void const*>(line));
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Records the accesses of the calling thread into the lines of one
+        // chunk while it is alive. The chunk is marked as recorded by
+        // commit(), a chunk which was not processed completely is
+        // recorded again during the next pass.
+        class recording
+        {
+        public:
+            recording(prefetch_schedule& s, std::size_t chunk)
+              : record_(s.chunk_at(chunk)), line_size_(s.line_size_),
+                previous_(current())
+            {
+                record_.lines.clear();
+                current() = this;
+            }
+
+            ~recording()
+            {
+                current() = previous_;
+            }
+
+            recording(recording const&) = delete;
+            recording& operator=(recording const&) = delete;
+
+            void commit()
+            {
+                record_.recorded.store(true, std::memory_order_release);
+            }
+
+            // consecutive accesses to the same line are recorded once
+            void record(void const* p)
+            {
+                std::uintptr_t const line =
+                    reinterpret_cast<std::uintptr_t>(p) &
+                        ~std::uintptr_t(line_size_ - 1);
+                if (record_.lines.empty() || record_.lines.back() != line)
+                    record_.lines.push_back(line);
+            }
+
+            // the recording of the calling thread, if any
+            static recording*& current()
+            {
+                static thread_local recording* current_recording = nullptr;
+                return current_recording;
+            }
+
+        private:
+            chunk_record& record_;
+            std::size_t line_size_;
+            recording* previous_;
+        };
+
+    private:
+        chunk_record& chunk_at(std::size_t chunk)
+        {
+            HPX_ASSERT(chunk < size_);
+            return chunks_[chunk];
+        }
+
+        std::unique_ptr<chunk_record[]> chunks_;
+        std::size_t size_;
+        std::size_t line_size_;
+    };
+
+    // Wrap an access inside of the body of a loop running over an
+    // inspected prefetcher_context, e.g. 'sum += record_access(x[nbr[j]]);'.
+    // The address is recorded if the current chunk is being recorded, the
+    // access itself is passed through unchanged.
+    template <typename T>
+    HPX_FORCEINLINE T& record_access(T& x)
+    {
+        if (prefetch_schedule::recording* r =
+                prefetch_schedule::recording::current())
+        {
+            r->record(&x);
+        }
+        return x;
+    }
+}}}
+
+#endif
@@ -21,6 +21,7 @@
 #include <hpx/include/iostreams.hpp>
 #include <hpx/include/threads.hpp>
 
+#include <hpx/parallel/util/cache_topology.hpp>
 #include <hpx/parallel/util/numa_allocator.hpp>
 
 #include <boost/format.hpp>
@@ -212,6 +213,8 @@ numa_domain_worker(std::size_t domain,
     Policy policy,
     hpx::lcos::local::latch& l, int vector_size,
     std::size_t part_size, std::size_t offset, std::size_t iterations, std::size_t prefetch_distance_factor,
+    std::size_t prefetch_distance, bool prefetch_bypass, bool bandwidth_throttle,
+    bool prefetch_budget,
     Vector& a, Vector& b, Vector& c)
 {
     typedef typename Vector::iterator iterator;
@@ -304,9 +307,12 @@ numa_domain_worker(std::size_t domain,
 
     /// parameters needed for comparing different for_each styles
     //minimum chunk_size is chosen with : cashe_size_line / sizeof(type)
-    std::size_t minimum_chunk_size = 64 / sizeof(STREAM_TYPE); 
+    std::size_t minimum_chunk_size =
+        hpx::parallel::util::get_cache_topology().prefetch_granularity /
+            sizeof(STREAM_TYPE);
     //There is prefetch_distance_factor number of minimum_chunk_sizes within each chunk 
-    std::size_t chunk_size = prefetch_distance_factor * minimum_chunk_size; 
+    std::size_t chunk_size = (prefetch_distance_factor == 0 ? 1 :
+        prefetch_distance_factor) * minimum_chunk_size;
     //number of chunk_size in data
     int chunk_count = vector_size / chunk_size; 
     //This range is used for Triad_for_each_1 and Triad_for_each_2
@@ -316,7 +322,27 @@ numa_domain_worker(std::size_t domain,
     auto unroll_range=boost::irange(0,chunk_count);						   
     //This range is used for Triad_prefetch_for_each_2_new_it using 
     //prefetching_iterator and with prefetching data within prefetching_iterator
-    auto ctx = hpx::parallel::util::detail::make_prefetcher_context(0,vector_size,prefetch_distance_factor,{a.data(),b.data(),c.data()}); 
+    //a is only written, b and c are read exactly once
+    using hpx::parallel::util::prefetch_hint;
+    using hpx::parallel::util::make_prefetch_container;
+    auto ctx = hpx::parallel::util::make_prefetcher_context(
+        original_range.begin(), original_range.end(),
+        prefetch_distance_factor,
+        make_prefetch_container(a, prefetch_hint::write),
+        make_prefetch_container(b, prefetch_hint::nta),
+        make_prefetch_container(c, prefetch_hint::nta));
+    if (prefetch_distance == 0)
+        ctx.enable_adaptive_distance();
+    else if (prefetch_distance_factor != 0)
+        ctx.prefetch_distance = prefetch_distance;
+    if (prefetch_bypass)
+        ctx.enable_prefetch_bypass();
+    if (bandwidth_throttle)
+        ctx.enable_bandwidth_throttle();
+    // the loops of all domains share the budget of the process
+    hpx::parallel::util::prefetch_budget_share budget_share;
+    if (prefetch_budget)
+        ctx.enable_prefetch_budget(budget_share);
 														   
 
 
@@ -412,12 +438,10 @@ numa_domain_worker(std::size_t domain,
 
 	hpx::parallel::for_each(hpx::parallel::par,
 		ctx.begin(), ctx.end(),
-		[&](std::size_t i)
-		{			
-			std::size_t from = i ;
-			std::size_t to = from + chunk_size;
-			for(int j=from ; j< std::min(to,a.size()); ++j)	
-				a[j]= b[j]+c[j] * 2.5;
+		[&](std::size_t first, std::size_t last)
+		{
+			for(std::size_t j = first; j != last; ++j)
+				a[j] = b[j] + c[j] * 2.5;
 		}
 	);
 
@@ -474,6 +498,14 @@ int hpx_main(boost::program_options::variables_map& vm)
     std::size_t offset = vm["offset"].as<std::size_t>();
     std::size_t iterations = vm["iterations"].as<std::size_t>();
     std::size_t prefetch_distance_factor = vm["prefetch_distance_factor"].as<std::size_t>();
+    std::size_t prefetch_distance = vm["prefetch_distance"].as<std::size_t>();
+    bool prefetch_bypass = vm.count("prefetch_bypass") != 0;
+    bool bandwidth_throttle = vm.count("bandwidth_throttle") != 0;
+    bool prefetch_budget = vm.count("prefetch_budget") != 0;
+
+    // measure the memory latency before any of the timed loops runs
+    if (prefetch_distance_factor == 0)
+        hpx::parallel::util::calibrate_prefetcher();
 
     std::string num_numa_domains_str = vm["stream-numa-domains"].as<std::string>();
 
@@ -549,7 +581,9 @@ int hpx_main(boost::program_options::variables_map& vm)
             workers.push_back(
                 hpx::async(execs[i], &numa_domain_worker<vector_type, decltype(policy)>,
                     i, policy, boost::ref(l),
-                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor,
+                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor, prefetch_distance,
+                    prefetch_bypass, bandwidth_throttle,
+                    prefetch_budget,
                     boost::ref(a), boost::ref(b), boost::ref(c))
             );
         }
@@ -559,7 +593,9 @@ int hpx_main(boost::program_options::variables_map& vm)
             workers.push_back(
                 hpx::async(execs[i], &numa_domain_worker<vector_type, decltype(policy)>,
                     i, policy, boost::ref(l),
-                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor,
+                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor, prefetch_distance,
+                    prefetch_bypass, bandwidth_throttle,
+                    prefetch_budget,
                     boost::ref(a), boost::ref(b), boost::ref(c))
             );
         }
@@ -569,7 +605,9 @@ int hpx_main(boost::program_options::variables_map& vm)
             workers.push_back(
                 hpx::async(execs[i], &numa_domain_worker<vector_type, decltype(policy)>,
                     i, policy, boost::ref(l),
-                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor,
+                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor, prefetch_distance,
+                    prefetch_bypass, bandwidth_throttle,
+                    prefetch_budget,
                     boost::ref(a), boost::ref(b), boost::ref(c))
             );
         }
@@ -580,7 +618,9 @@ int hpx_main(boost::program_options::variables_map& vm)
             workers.push_back(
                 hpx::async(execs[i], &numa_domain_worker<vector_type, decltype(policy)>,
                     i, policy, boost::ref(l),
-                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor,
+                    vector_size, part_size, part_size*i, iterations, prefetch_distance_factor, prefetch_distance,
+                    prefetch_bypass, bandwidth_throttle,
+                    prefetch_budget,
                     boost::ref(a), boost::ref(b), boost::ref(c))
             );
         }
@@ -707,7 +747,19 @@ int main(int argc, char* argv[])
             "number of iterations to repeat each test. (default: 10)")
 	(   "prefetch_distance_factor",
             boost::program_options::value<std::size_t>()->default_value(1),
-            "Distance (in chunk_size) between each preteching data. (default: 1)")
+            "Distance (in chunk_size) between each preteching data, 0 "
+            "calibrates the prefetch distance at startup. (default: 1)")
+        (   "prefetch_distance",
+            boost::program_options::value<std::size_t>()->default_value(1),
+            "Number of chunks the prefetches run ahead of the computation, "
+            "0 tunes the distance while running. (default: 1)")
+        (   "prefetch_bypass",
+            "leave the unit-stride streams to the hardware prefetcher")
+        (   "bandwidth_throttle",
+            "scale back the prefetches while the bandwidth of a NUMA domain "
+            "is saturated")
+        (   "prefetch_budget",
+            "split the capacity for prefetched data between the domains")
         (   "stream-threads",
             boost::program_options::value<std::string>()->default_value("all"),
             "number of threads per NUMA domain to use. (default: all)")